@@ -0,0 +1,422 @@
+// Here we keep the users' aliases, e.g. "alias ll ls -l", in a hash table keyed on the alias name
+// An alias may begin with another alias, e.g. "alias la ll -a". Rather than following that chain on every command,
+// each alias stores its full expansion ("ls -l -a"), which is worked out whenever an alias is added or removed. This is
+// also when circular aliases are caught, so they can never be added in the first place. Looking up an alias is then a
+// single hash of the first word of the command, with nothing allocated. The alias file isn't read until an alias is
+// first needed, see useAliases()
+
+AliasEntry *aliasTable = NULL; // Open addressing table of aliases, NULL until the first alias is added
+int aliasSize = 0; // Number of slots in aliasTable, always a power of 2
+int aliasCount = 0; // Number of aliases
+int aliasesLoaded = 0; // 1 once the alias file has been read, see useAliases()
+
+
+/* FNV-1a hash of the first length characters of name */
+unsigned int aliasHash(char *name, size_t length) {
+    unsigned int h = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i) {
+        h ^= (unsigned char) name[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+
+/**
+ * Find the slot for an alias, using linear probing
+ * @param name The name of the alias, which need not be NUL terminated
+ * @param length Number of characters in name
+ * @return Index of the slot holding the alias, or the empty slot where it should be inserted
+ */
+int aliasSlot(char *name, size_t length) {
+    int i = aliasHash(name, length) & (aliasSize - 1);
+
+    while (aliasTable[i].name != NULL &&
+           (strlen(aliasTable[i].name) != length || strncmp(aliasTable[i].name, name, length) != 0)) {
+        i = (i + 1) & (aliasSize - 1);
+    }
+
+    return i;
+}
+
+
+/* Double the size of the alias table (or create it), the table is kept at most half full */
+void aliasGrow() {
+    AliasEntry *old = aliasTable;
+    int oldSize = aliasSize;
+
+    aliasSize = (oldSize == 0) ? ALIAS_SIZE : oldSize * 2;
+    aliasTable = calloc(aliasSize, sizeof(AliasEntry));
+
+    for (int i = 0; i < oldSize; ++i) {
+        if (old[i].name != NULL) {
+            aliasTable[aliasSlot(old[i].name, strlen(old[i].name))] = old[i];
+        }
+    }
+
+    free(old);
+}
+
+
+/**
+ * Find an alias by name
+ * @param name The name of the alias, NUL terminated
+ * @return The alias, or NULL if there is no such alias
+ */
+AliasEntry *getAlias(char *name) {
+    if (aliasTable == NULL) { return NULL; }
+
+    int slot = aliasSlot(name, strlen(name));
+    return (aliasTable[slot].name != NULL) ? &aliasTable[slot] : NULL;
+}
+
+
+/**
+ * Work out the full expansion of an alias, by repeatedly replacing the first word with the alias it names
+ * Expansion stops at a word that isn't an alias, or that names the alias it came from, e.g. "alias ls ls -a"
+ *
+ * @param alias The alias to expand
+ * @param visited Space for aliasCount aliases, used to spot a chain that loops back on itself
+ * @return A newly allocated expansion, or NULL if the alias is circular
+ */
+char *flattenAlias(AliasEntry *alias, AliasEntry **visited) {
+    char *expansion = strdup(alias->command);
+    AliasEntry *current = alias;
+    int nVisited = 0;
+
+    visited[nVisited++] = alias;
+
+    for (;;) {
+        char *first = expansion + strspn(expansion, DELIMITERS);
+        size_t length = strcspn(first, WORD_END);
+
+        // The first word is the alias we just expanded, it refers to the real command, e.g. "alias ls ls -a"
+        if (strlen(current->name) == length && strncmp(current->name, first, length) == 0) { break; }
+
+        int slot = aliasSlot(first, length);
+        AliasEntry *next = (aliasTable[slot].name != NULL) ? &aliasTable[slot] : NULL;
+        if (next == NULL) { break; }
+
+        for (int i = 0; i < nVisited; ++i) {
+            if (visited[i] == next) {
+                free(expansion);
+                return NULL;
+            }
+        }
+
+        // Replace the first word with the alias it names
+        char *rest = first + length;
+        char *expanded = malloc(strlen(next->command) + strlen(rest) + 1);
+        strcpy(expanded, next->command);
+        strcat(expanded, rest);
+
+        free(expansion);
+        expansion = expanded;
+        visited[nVisited++] = next;
+        current = next;
+    }
+
+    return expansion;
+}
+
+
+/**
+ * Work out the expansion of every alias again, after one has been added, changed or removed
+ * @return The first alias found to be circular, or NULL if there are none
+ */
+AliasEntry *rebuildAliases() {
+    AliasEntry **visited = malloc((aliasCount + 1) * sizeof(AliasEntry *));
+    AliasEntry *circular = NULL;
+
+    for (int i = 0; i < aliasSize; ++i) {
+        if (aliasTable[i].name == NULL) { continue; }
+
+        free(aliasTable[i].expansion);
+        aliasTable[i].expansion = flattenAlias(&aliasTable[i], visited);
+
+        if (aliasTable[i].expansion == NULL && circular == NULL) { circular = &aliasTable[i]; }
+    }
+
+    free(visited);
+    return circular;
+}
+
+
+/**
+ * Add an alias to the table without working out any expansions, replacing any existing alias with the same name
+ * @param name The name of the alias
+ * @param command The command it stands for
+ * @return The previous command for this alias, which the caller should free, or NULL if this is a new alias
+ */
+char *insertAlias(char *name, char *command) {
+    if (aliasTable == NULL || (aliasCount + 1) * 2 > aliasSize) { aliasGrow(); }
+
+    int slot = aliasSlot(name, strlen(name));
+
+    if (aliasTable[slot].name != NULL) {
+        char *previous = aliasTable[slot].command;
+        aliasTable[slot].command = strdup(command);
+        return previous;
+    }
+
+    aliasTable[slot].name = strdup(name);
+    aliasTable[slot].command = strdup(command);
+    aliasTable[slot].expansion = NULL;
+    aliasCount++;
+
+    return NULL;
+}
+
+
+/**
+ * Remove an alias from the table without working out any expansions
+ * Entries after it in the same probe sequence are re-inserted so that they can still be found
+ *
+ * @param name The name of the alias
+ * @return 0 on success, 1 if there is no such alias
+ */
+int removeAlias(char *name) {
+    AliasEntry *alias = getAlias(name);
+    if (alias == NULL) { return 1; }
+
+    int slot = alias - aliasTable;
+    free(alias->name);
+    free(alias->command);
+    free(alias->expansion);
+    alias->name = NULL;
+    aliasCount--;
+
+    // Re-insert the rest of the cluster
+    int i = (slot + 1) & (aliasSize - 1);
+    while (aliasTable[i].name != NULL) {
+        AliasEntry entry = aliasTable[i];
+        aliasTable[i].name = NULL;
+        aliasTable[aliasSlot(entry.name, strlen(entry.name))] = entry;
+        i = (i + 1) & (aliasSize - 1);
+    }
+
+    return 0;
+}
+
+
+/**
+ * Load aliases from the .alias file in the users' home directory
+ * Each line holds the name of an alias and its command, separated by a tab. Expansions are worked out once every alias
+ * has been loaded, as an alias may refer to one further down the file
+ * Called the first time an alias is needed, or at startup with -v
+ */
+void initialiseAlias() {
+    if (aliasesLoaded) { return; }
+    aliasesLoaded = 1;
+
+    // Aliases are kept in the users' home directory, scripts may be running elsewhere
+    char *path = malloc(strlen(getHome()) + strlen("/.alias") + 1);
+    strcpy(path, getHome());
+    strcat(path, "/.alias");
+
+    FILE *fp = fopen(path, "r");
+    free(path);
+
+    if (fp == NULL) { return; }
+
+    char *buffer = NULL; // Input buffer for file reading, grown by getline() as needed
+    size_t bufferSize = 0;
+
+    while (getline(&buffer, &bufferSize, fp) > 0) {
+        char *name = strtok(buffer, "\t");
+        char *command = strtok(NULL, "\n");
+        if (name == NULL || command == NULL) { continue; }
+
+        free(insertAlias(name, command));
+    }
+
+    fclose(fp);
+    free(buffer);
+
+    // Drop any circular aliases, these can only appear if the file has been edited by hand
+    AliasEntry *circular;
+    while (aliasTable != NULL && (circular = rebuildAliases()) != NULL) {
+        yellow("[Warning] ");
+        printf("The alias \"%s\" is circular, it has not been loaded\n", circular->name);
+        removeAlias(circular->name);
+    }
+
+    if (verbose) {
+        blue("[Info] ");
+        printf("Aliases loaded from file\n");
+    }
+}
+
+
+/* Load aliases the first time they are needed */
+void useAliases() {
+    if (!aliasesLoaded) { initialiseAlias(); }
+}
+
+
+/**
+ * Add a new alias. If the alias already exists, it is replaced
+ * An alias which would lead back to itself, e.g. "alias a b" when b is an alias for "a", is refused
+ *
+ * @param name The alias of the command
+ * @param command The command to be aliased, along with its arguments
+ * @return 0 on success, 1 if the alias was not added
+ */
+int addAlias(char *name, char *command) {
+    useAliases();
+
+    if (strcmp(name, command) == 0) {
+        red("[Error] "); printf("You can not alias a command as itself. Please try again.\n");
+        return 1;
+    }
+
+    AliasEntry *existing = getAlias(name);
+
+    if (existing != NULL && strcmp(existing->command, command) == 0) {
+        blue("[Info] ");
+        printf("You already have an alias with this name and command. Nothing to change.\n");
+        return 0;
+    }
+
+    char *previous = insertAlias(name, command);
+
+    // Would this alias lead back to itself? If so put back whatever was there before
+    if (rebuildAliases() != NULL) {
+        if (previous != NULL) { free(insertAlias(name, previous)); }
+        else { removeAlias(name); }
+        rebuildAliases();
+        free(previous);
+
+        red("[Error] ");
+        printf("\"%s\" would be a circular alias. Try \"unalias <command>\" to resolve.\n", name);
+        return 1;
+    }
+
+    if (previous != NULL) {
+        yellow("[Warning] ");
+        printf("\"%s\" is already an alias for the command \"%s\"\n", name, previous);
+
+        blue("[Info] ");
+        printf("Overriding the alias \"%s\" to be the new command \"%s\"\n", name, command);
+        free(previous);
+    } else {
+        blue("[Info] "); printf("Added \"%s\" under the alias \"%s\"\n", command, name);
+    }
+
+    return 0;
+}
+
+
+/**
+ * Remove an aliased command if it exists
+ * @param name The alias to be removed
+ * @return 0 on success, 1 if there is no such alias
+ */
+int unAlias(char *name) {
+    useAliases();
+    AliasEntry *alias = getAlias(name);
+
+    if (alias == NULL) {
+        yellow("[Warning] "); printf("Could not find an alias \"%s\", therefore it could not be removed!\n", name);
+        return 1;
+    }
+
+    blue("[Info] "); printf("Removing alias %s for %s\n", alias->name, alias->command);
+    removeAlias(name);
+    rebuildAliases(); // Aliases which referred to this one now expand differently
+
+    return 0;
+}
+
+
+/**
+ * Find the expansion of an alias, e.g. for the command "ll /tmp", findAlias("ll /tmp", 2) gives "ls -l"
+ * @param name The first word of the command, which need not be NUL terminated
+ * @param length Number of characters in the first word
+ * @return The fully expanded command for the alias, or NULL if the word isn't an alias
+ */
+char *findAlias(char *name, size_t length) {
+    useAliases();
+    if (aliasCount == 0) { return NULL; }
+
+    int slot = aliasSlot(name, length);
+    return aliasTable[slot].name != NULL ? aliasTable[slot].expansion : NULL;
+}
+
+
+/* Compare two aliases by name, for qsort() */
+int compareAliases(const void *a, const void *b) {
+    return strcmp((*(AliasEntry **) a)->name, (*(AliasEntry **) b)->name);
+}
+
+
+/**
+ * Collect every alias, sorted by name
+ * @return A newly allocated array of aliasCount aliases
+ */
+AliasEntry **sortedAliases() {
+    AliasEntry **sorted = malloc((aliasCount + 1) * sizeof(AliasEntry *));
+    int n = 0;
+
+    for (int i = 0; i < aliasSize; ++i) {
+        if (aliasTable[i].name != NULL) { sorted[n++] = &aliasTable[i]; }
+    }
+
+    qsort(sorted, n, sizeof(AliasEntry *), compareAliases);
+    return sorted;
+}
+
+
+/* Display all of the users alias', sorted by name */
+void dispAlias() {
+    useAliases();
+
+    // Check there are some alias' to display
+    if (aliasCount == 0) {
+        blue("[Info] ");
+        printf("There are currently no aliased commands. Add an alias with \"alias <name> <command>\"\n");
+        return;
+    }
+
+    AliasEntry **sorted = sortedAliases();
+
+    blue(" = Alias Begin =\n");
+    printf(" Name\tCommand\n");
+
+    for (int i = 0; i < aliasCount; ++i) {
+        printf(" \"%s\"\t\"%s\"\n", sorted[i]->name, sorted[i]->command);
+    }
+
+    blue(" = Alias End =\n");
+    free(sorted);
+}
+
+
+/**
+ * Save every alias to a file, one per line as "<name>\t<command>"
+ * Nothing is written if aliases were never loaded, as nothing can have changed
+ *
+ * @param file The file to write to, any existing content is replaced
+ * @return 0 on success, 1 if the file could not be written
+ */
+int saveAliases(char *file) {
+    if (!aliasesLoaded) { return 0; }
+
+    FILE *fp = fopen(file, "w");
+    if (fp == NULL) { return 1; }
+
+    if (aliasCount > 0) {
+        AliasEntry **sorted = sortedAliases();
+
+        for (int i = 0; i < aliasCount; ++i) {
+            fprintf(fp, "%s\t%s\n", sorted[i]->name, sorted[i]->command);
+        }
+
+        free(sorted);
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,983 @@
+// Here we measure how fast the shell is, both to start and to run commands
+//
+// ./SimpleShell --bench-startup 100 starts a fresh copy of the shell in a pseudo-terminal each run, exactly as a
+// terminal emulator would, and times how long it takes from starting the process to the prompt appearing. The shell is
+// then closed with Ctrl+D. Any other options given, e.g. -v, are passed on to the shells started, so that their startup
+// can be compared
+//
+// ./SimpleShell --bench-launch 1000 starts /bin/true 1000 times with each launch mode (see launcher.c), both as the
+// shell starts and after it has grown, reporting the p50 and p99 time from launching it to reaping it
+//
+// ./SimpleShell --bench-pipe 4 pushes 4GB from head through pipelines of two to four commands, with the default pipe
+// capacity and with BENCH_PIPE_SIZE (see pipesize), reporting how fast the data went through each
+//
+// ./SimpleShell --bench-parse bench/parse/lexer.txt times lexing each line of a corpus, reporting the p50 and p99 time per
+// line. Each line is then mutated many times, e.g. with quotes and operators dropped in at random, and the lexer is
+// checked to return sensible tokens for every mutation without crashing, see fuzzLine()
+//
+// ./SimpleShell --bench-lines 100 times lexing generated lines from 100 bytes to 1MB long, such as rm with thousands
+// of files, reporting the p50 and p99 time for each length
+//
+// ./SimpleShell --replay bench/*.txt replays files of recorded commands (corpora), one command per line, and reports
+// how long each line took. By default the lines are run by this shell, as if they had been read from a script, and
+// the time taken by each stage of running a line (see Timer) is reported too. With --pty each line is typed into a
+// new shell running in a pseudo-terminal instead, timing from the line being entered to the next prompt appearing.
+// Replays use a new, empty home directory, so the users' own history and aliases are left alone. A corpus shouldn't
+// contain exit, as that would exit the replay.
+// --save-baseline <file> saves the times, and --baseline <file> compares against times saved earlier, exiting with
+// status 1 if any stage has slowed down by more than REPLAY_TOLERANCE, see fastestMedians()
+
+#define LINE_TIME TIMER_COUNT /* Index in Replay.times of the time taken by the whole line */
+
+
+/* Name of a stage timed by a replay */
+char *stageName(int stage) {
+    return (stage == LINE_TIME) ? "line" : TIMER_NAMES[stage];
+}
+
+
+/* Compare two times, for qsort() */
+int compareTimes(const void *a, const void *b) {
+    double x = *(double *) a, y = *(double *) b;
+    return (x > y) - (x < y);
+}
+
+
+/* Sort times into increasing order, ready for percentile() */
+void sortTimes(double *times, int n) {
+    qsort(times, n, sizeof(double), compareTimes);
+}
+
+
+/**
+ * Find a percentile of a set of times, using the nearest rank
+ * @param times The times, sorted into increasing order
+ * @param n Number of times
+ * @param fraction Fraction of the times which should be no more than the result, e.g. 0.5 for the median
+ * @return The time, or 0 if there are no times
+ */
+double percentile(double *times, int n, double fraction) {
+    if (n == 0) { return 0; }
+
+    int rank = (int) (fraction * n + 0.999999); // Rounded up, so the 99th percentile of 10 times is the largest
+    if (rank < 1) { rank = 1; }
+    if (rank > n) { rank = n; }
+
+    return times[rank - 1];
+}
+
+
+/* Milliseconds since start, a time from nanoseconds() */
+double millisecondsSince(long long start) {
+    return (nanoseconds() - start) / 1000000.0;
+}
+
+
+/**
+ * Read what the shell writes to the terminal until it shows a prompt, i.e. until PROMPT appears
+ * @param terminal The pseudo-terminal the shell is running in
+ * @param start When to time from, a time from nanoseconds()
+ * @return Milliseconds from start until the prompt appeared, or -1 if it didn't appear within BENCH_TIMEOUT_MS
+ */
+double waitForPrompt(int terminal, long long start) {
+    char buffer[4096];
+    size_t kept = 0; // Bytes carried over from the last read, in case PROMPT was split between reads
+    size_t promptLength = strlen(PROMPT);
+
+    for (;;) {
+        int remaining = BENCH_TIMEOUT_MS - (int) millisecondsSince(start);
+        struct pollfd waiting = { terminal, POLLIN, 0 };
+
+        if (remaining <= 0 || poll(&waiting, 1, remaining) <= 0) { return -1; }
+
+        ssize_t count = read(terminal, buffer + kept, sizeof(buffer) - kept);
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { return -1; } // The shell exited without showing a prompt
+
+        size_t length = kept + count;
+        if (memmem(buffer, length, PROMPT, promptLength) != NULL) { return millisecondsSince(start); }
+
+        kept = (length < promptLength) ? length : promptLength - 1;
+        memmove(buffer, buffer + length - kept, kept);
+    }
+}
+
+
+/* Read anything the shell has written to the terminal that hasn't been read yet, without waiting */
+void drainTerminal(int terminal) {
+    char buffer[4096];
+    struct pollfd waiting = { terminal, POLLIN, 0 };
+
+    while (poll(&waiting, 1, 0) > 0 && read(terminal, buffer, sizeof(buffer)) > 0) {}
+}
+
+
+/**
+ * Start a copy of the shell in a new pseudo-terminal
+ * @param arguments Arguments for the shell
+ * @param pid Set to the process id of the shell
+ * @return The pseudo-terminal, to type into and read the shell's output from, or -1 on error
+ */
+int startInTerminal(char *arguments[], pid_t *pid) {
+    int terminal = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (terminal < 0 || grantpt(terminal) != 0 || unlockpt(terminal) != 0) {
+        if (terminal >= 0) { close(terminal); }
+        return -1;
+    }
+
+    struct winsize size = { .ws_row = 24, .ws_col = 80 };
+    ioctl(terminal, TIOCSWINSZ, &size);
+    char *name = ptsname(terminal);
+
+    *pid = fork();
+
+    if (*pid == 0) {
+        // A new session, so that the terminal becomes the shell's controlling terminal just as it would normally
+        setsid();
+        int shellTerminal = open(name, O_RDWR);
+        if (shellTerminal < 0) { _exit(127); }
+        ioctl(shellTerminal, TIOCSCTTY, 0);
+
+        dup2(shellTerminal, STDIN_FILENO);
+        dup2(shellTerminal, STDOUT_FILENO);
+        dup2(shellTerminal, STDERR_FILENO);
+        if (shellTerminal > STDERR_FILENO) { close(shellTerminal); }
+
+        execv("/proc/self/exe", arguments);
+        _exit(127);
+    }
+
+    if (*pid < 0) {
+        close(terminal);
+        return -1;
+    }
+
+    return terminal;
+}
+
+
+/**
+ * Close a shell started by startInTerminal(), reading anything it writes until it has gone
+ * @param terminal The pseudo-terminal the shell is running in, which is closed
+ * @param pid Process id of the shell
+ * @param killShell 1 to kill the shell straight away, 0 to exit it with Ctrl+D
+ */
+void stopInTerminal(int terminal, pid_t pid, int killShell) {
+    char buffer[4096];
+    struct pollfd waiting = { terminal, POLLIN, 0 };
+
+    if (killShell) { kill(pid, SIGKILL); }
+    else { write(terminal, "\4", 1); }
+
+    while (poll(&waiting, 1, BENCH_TIMEOUT_MS) > 0 && read(terminal, buffer, sizeof(buffer)) > 0) {}
+
+    kill(pid, SIGKILL); // In case it is still running after the timeout
+    waitpid(pid, NULL, 0);
+    close(terminal);
+}
+
+
+/**
+ * Start one copy of the shell in a new pseudo-terminal, wait for its prompt, then close it
+ * @param arguments Arguments for the shell
+ * @return Milliseconds taken to show the prompt, or -1 on failure
+ */
+double startupRun(char *arguments[]) {
+    pid_t pid;
+    long long start = nanoseconds();
+
+    int terminal = startInTerminal(arguments, &pid);
+    if (terminal < 0) { return -1; }
+
+    double time = waitForPrompt(terminal, start);
+    stopInTerminal(terminal, pid, time < 0);
+
+    return time;
+}
+
+
+/**
+ * Start the shell in a terminal runs times, reporting how long it took to show the first prompt
+ * @param runs Number of times to start the shell
+ * @return 0 on success, 1 if a shell failed to show its prompt
+ */
+int benchStartup(int runs) {
+    char *arguments[] = { "SimpleShell", verbose ? "-v" : NULL, NULL };
+    double *times = malloc(runs * sizeof(double));
+    double total = 0;
+
+    for (int i = 0; i < runs; ++i) {
+        times[i] = startupRun(arguments);
+
+        if (times[i] < 0) {
+            red("[Error] ");
+            printf("The shell didn't show a prompt within %ims\n", BENCH_TIMEOUT_MS);
+            free(times);
+            return 1;
+        }
+
+        total += times[i];
+    }
+
+    sortTimes(times, runs);
+
+    blue("[Info] ");
+    printf("Time to first prompt over %i runs: mean %.2fms, min %.2fms, p50 %.2fms, p99 %.2fms, max %.2fms\n",
+           runs, total / runs, times[0], percentile(times, runs, 0.5), percentile(times, runs, 0.99), times[runs - 1]);
+
+    free(times);
+    return 0;
+}
+
+
+/**
+ * Time starting and reaping a command runs times with the current launch mode
+ * @param path Path to the command, which should exit straight away
+ * @param times Filled with the microseconds each run took, then sorted
+ * @param runs Number of times to start the command
+ * @return 0 on success, 1 if the command couldn't be started
+ */
+int launchRuns(char *path, double *times, int runs) {
+    char *argv[] = { path, NULL };
+    LaunchIO io = { -1, -1, -1, 0, NULL, 0, 0 };
+
+    for (int i = 0; i < runs; ++i) {
+        long long start = nanoseconds();
+
+        pid_t pid = launchProcess(path, argv, &io);
+        if (pid < 0) { return 1; }
+        waitpid(pid, NULL, 0);
+
+        times[i] = (nanoseconds() - start) / 1000.0;
+    }
+
+    sortTimes(times, runs);
+    return 0;
+}
+
+
+/**
+ * Compare how long each launch mode takes to start a command and see it exit, first with the shell as it starts, then
+ * after it has grown by BENCH_LAUNCH_PADDING megabytes. Fork slows down as the shell grows, the zygote shouldn't
+ *
+ * @param runs Number of commands started with each launch mode at each size
+ * @return 0 on success, 1 if a command couldn't be started
+ */
+int benchLaunch(int runs) {
+    char *path = hashLookup("true");
+    double *times = malloc(runs * sizeof(double));
+    char *padding = NULL;
+
+    if (path == NULL) {
+        red("[Error] ");
+        printf("Unable to find true on the PATH, which is used to time launching commands\n");
+        free(times);
+        return 1;
+    }
+
+    if (startZygote() != 0) {
+        free(times);
+        return 1;
+    }
+
+    blue("[Info] ");
+    printf("Time to start and reap %s over %i runs, in microseconds\n", path, runs);
+    printf("%-12s %-8s %10s %10s\n", "Shell size", "Mode", "p50", "p99");
+
+    for (int grown = 0; grown <= 1; ++grown) {
+        char size[32];
+        snprintf(size, sizeof(size), grown ? "+%iMB" : "Startup", BENCH_LAUNCH_PADDING);
+
+        // Touch every page, so that fork has to copy the page tables for all of it
+        if (grown) {
+            padding = malloc((size_t) BENCH_LAUNCH_PADDING << 20);
+            memset(padding, 1, (size_t) BENCH_LAUNCH_PADDING << 20);
+        }
+
+        for (int mode = 0; mode < (int) (sizeof(LAUNCH_MODES) / sizeof(LAUNCH_MODES[0])); ++mode) {
+            launchMode = mode;
+
+            if (launchRuns(path, times, runs) != 0) {
+                free(padding);
+                free(times);
+                return 1;
+            }
+
+            printf("%-12s %-8s %10.1f %10.1f\n", size, LAUNCH_MODES[mode],
+                   percentile(times, runs, 0.5), percentile(times, runs, 0.99));
+        }
+    }
+
+    free(padding);
+    free(times);
+    return 0;
+}
+
+
+/**
+ * Run a line of commands in this shell, as if it had been read from a script
+ * @param line The commands to run
+ * @return The exit status of the last command
+ */
+int benchLine(char *line) {
+    static int tCapacity = TOKENS_INITIAL;
+    static char **tokens = NULL;
+    char *command = strdup(line); // The lexer changes the line as it splits it up
+
+    if (tokens == NULL) { tokens = malloc((tCapacity + 1) * sizeof(char *)); }
+
+    int n = parseInput(command, &tokens, &tCapacity);
+    int status = (n > 0) ? runList(tokens, n) : lastStatus;
+
+    free(command);
+    return status;
+}
+
+
+/**
+ * Time pushing data through pipelines of two, three and four commands, e.g. "head -c 1G /dev/zero | cat | wc -c", both
+ * with the default pipe capacity and with BENCH_PIPE_SIZE bytes. Each pipeline is run by this shell, so this measures
+ * the pipes runPipeline() sets up between the stages
+ *
+ * @param gigabytes Number of gigabytes pushed through each pipeline
+ * @return 0 on success, 1 if a pipeline failed
+ */
+int benchPipe(int gigabytes) {
+    int sizes[] = { 0, BENCH_PIPE_SIZE };
+    long long bytes = (long long) gigabytes << 30;
+
+    initialiseJobs();
+
+    blue("[Info] ");
+    printf("Time to push %iGB through each pipeline\n", gigabytes);
+    printf("%-8s %-12s %10s %10s\n", "Stages", "Pipe size", "Seconds", "GB/s");
+
+    for (int s = 0; s < (int) (sizeof(sizes) / sizeof(sizes[0])); ++s) {
+        char size[32];
+        if (sizes[s] == 0) { snprintf(size, sizeof(size), "Default"); }
+        else { snprintf(size, sizeof(size), "%iKB", sizes[s] >> 10); }
+
+        for (int stages = 2; stages <= 4; ++stages) {
+            char line[256];
+            int w = snprintf(line, sizeof(line), "head -c %lli /dev/zero", bytes);
+            for (int i = 2; i < stages; ++i) { w += snprintf(line + w, sizeof(line) - w, " | cat"); }
+            snprintf(line + w, sizeof(line) - w, " | wc -c > /dev/null");
+
+            pipeSize = sizes[s];
+            fflush(stdout);
+            long long start = nanoseconds();
+
+            if (benchLine(line) != 0) {
+                red("[Error] ");
+                printf("The pipeline failed: %s\n", line);
+                pipeSize = 0;
+                return 1;
+            }
+
+            double seconds = (nanoseconds() - start) / 1000000000.0;
+            printf("%-8i %-12s %10.2f %10.2f\n", stages, size, seconds, gigabytes / seconds);
+        }
+    }
+
+    pipeSize = 0;
+    return 0;
+}
+
+
+/**
+ * Read a corpus of commands, one per line. Empty lines, and comments starting with #, are skipped over
+ * @param path The corpus file
+ * @param n Set to the number of commands read
+ * @return The commands, each ending in a newline, or NULL if the file couldn't be read
+ */
+char **readCorpus(char *path, int *n) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) { return NULL; }
+
+    char **lines = NULL;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+
+    *n = 0;
+    while ((length = getline(&line, &size, fp)) > 0) {
+        if (line[strspn(line, " \t\n")] == '\0' || line[0] == '#') { continue; }
+        if (line[length - 1] == '\n') { length--; } // The last line may not end in one, so add it back to every line
+
+        lines = realloc(lines, (*n + 1) * sizeof(char *));
+        lines[*n] = malloc(length + 2);
+        memcpy(lines[*n], line, length);
+        strcpy(lines[(*n)++] + length, "\n");
+    }
+
+    free(line);
+    fclose(fp);
+    return lines;
+}
+
+
+/**
+ * Lex a line runs times, timing each. The line is copied into buffer first each time, as lexLine() changes it
+ * @param line The line to lex
+ * @param buffer Somewhere to lex the line, at least as long as it
+ * @param times Filled with the nanoseconds each run took, then sorted
+ * @param runs Number of times to lex the line
+ */
+void lexRuns(char *line, char *buffer, double *times, int runs) {
+    static int capacity = TOKENS_INITIAL;
+    static char **tokens = NULL;
+    size_t length = strlen(line) + 1;
+
+    if (tokens == NULL) { tokens = malloc((capacity + 1) * sizeof(char *)); }
+
+    for (int i = 0; i < runs; ++i) {
+        memcpy(buffer, line, length);
+        long long start = nanoseconds();
+        lexLine(buffer, &tokens, &capacity);
+        times[i] = nanoseconds() - start;
+    }
+
+    sortTimes(times, runs);
+}
+
+
+/**
+ * Lex a line and check the tokens make sense: each is either an operator or a word in the line, and the words follow
+ * one another in order without overlapping
+ *
+ * @param line The line to lex, which is changed
+ * @param length Length of the line
+ * @return 0 if the tokens make sense, otherwise 1
+ */
+int fuzzLine(char *line, size_t length) {
+    static int capacity = TOKENS_INITIAL;
+    static char **tokens = NULL;
+    char *end = line; // End of the last word, the next word must start after it
+
+    if (tokens == NULL) { tokens = malloc((capacity + 1) * sizeof(char *)); }
+
+    int n = lexLine(line, &tokens, &capacity);
+    if (n < 0) { return 0; } // A quote was left open, which is reported to the user
+    if (tokens[n] != NULL) { return 1; }
+
+    for (int i = 0; i < n; ++i) {
+        if (operatorType(tokens[i]) != OP_NONE) { continue; }
+        if (tokens[i] < end || tokens[i] >= line + length) { return 1; }
+
+        end = tokens[i] + strlen(tokens[i]) + 1;
+        if (end > line + length + 1) { return 1; }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Time lexing each line of each corpus given, then fuzz the lexer by mutating every line BENCH_PARSE_MUTATIONS times,
+ * e.g. "ls | wc" might become "ls \"| w'c". The mutations are the same each run, so a failure can be repeated
+ *
+ * @param argc Number of corpora
+ * @param argv File names of the corpora
+ * @return 0 on success, 1 if a corpus couldn't be read or the lexer got a mutation wrong, 2 on bad usage
+ */
+int benchParse(int argc, char const *argv[]) {
+    char fuzzChars[] = " \t\n\\\"'|<>&;$?*[2x"; // Mutations mostly use characters the lexer treats specially
+    unsigned int seed = 1;
+    int status = 0;
+    long fuzzed = 0;
+
+    if (argc == 0) {
+        fprintf(stderr, "Usage: SimpleShell --bench-parse <corpus>...\n");
+        return 2;
+    }
+
+    double *times = malloc(BENCH_PARSE_RUNS * sizeof(double));
+
+    blue("[Info] ");
+    printf("Time to lex each line over %i runs, in nanoseconds\n", BENCH_PARSE_RUNS);
+    printf("%-16s %8s %10s %10s %10s\n", "Corpus", "Lines", "p50", "p99", "MB/s");
+
+    for (int c = 0; c < argc; ++c) {
+        int n;
+        char **lines = readCorpus((char *) argv[c], &n);
+
+        if (lines == NULL || n == 0) {
+            red("[Error] ");
+            printf("Unable to read any commands from %s\n", argv[c]);
+            status = 1;
+            continue;
+        }
+
+        // Errors for quotes left open are thrown away, as printing them would be timed too
+        fflush(stdout);
+        int output = dup(STDOUT_FILENO);
+        int nowhere = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        dup2(nowhere, STDOUT_FILENO);
+        close(nowhere);
+
+        // The median of every line's median, and the slowest line's p99
+        double *medians = malloc(n * sizeof(double));
+        double p99 = 0, bytes = 0, total = 0;
+
+        for (int i = 0; i < n; ++i) {
+            size_t length = strlen(lines[i]);
+            char *buffer = malloc(length + 1);
+
+            lexRuns(lines[i], buffer, times, BENCH_PARSE_RUNS);
+            medians[i] = percentile(times, BENCH_PARSE_RUNS, 0.5);
+            if (percentile(times, BENCH_PARSE_RUNS, 0.99) > p99) { p99 = percentile(times, BENCH_PARSE_RUNS, 0.99); }
+            bytes += length;
+            total += medians[i];
+
+            free(buffer);
+        }
+
+        sortTimes(medians, n);
+
+        // Fuzz: replace, insert or remove a few characters of each line at a time
+        char *failed = NULL;
+
+        for (int i = 0; i < n && failed == NULL; ++i) {
+            size_t length = strlen(lines[i]);
+            char *mutated = malloc(length + BENCH_PARSE_EDITS + 1);
+            char *copy = malloc(length + BENCH_PARSE_EDITS + 1);
+
+            for (int m = 0; m < BENCH_PARSE_MUTATIONS && failed == NULL; ++m) {
+                size_t l = length;
+                memcpy(mutated, lines[i], length + 1);
+
+                for (int e = 1 + rand_r(&seed) % BENCH_PARSE_EDITS; e > 0; --e) {
+                    size_t at = (l > 0) ? rand_r(&seed) % l : 0;
+                    char with = fuzzChars[rand_r(&seed) % (sizeof(fuzzChars) - 1)];
+
+                    int edit = rand_r(&seed) % 3;
+
+                    if (edit == 0 && l > 0) { // Replace
+                        mutated[at] = with;
+                    } else if (edit == 1 || l == 0) { // Insert
+                        memmove(mutated + at + 1, mutated + at, l++ - at + 1);
+                        mutated[at] = with;
+                    } else { // Remove
+                        memmove(mutated + at, mutated + at + 1, l-- - at);
+                    }
+                }
+
+                memcpy(copy, mutated, l + 1);
+                if (fuzzLine(copy, l) != 0) { failed = strdup(mutated); }
+                fuzzed++;
+            }
+
+            free(mutated);
+            free(copy);
+        }
+
+        fflush(stdout);
+        dup2(output, STDOUT_FILENO);
+        close(output);
+
+        char *base = strrchr(argv[c], '/');
+        printf("%-16s %8i %10.0f %10.0f %10.1f\n", base ? base + 1 : argv[c], n, percentile(medians, n, 0.5), p99,
+               bytes / total * 1000);
+        free(medians);
+
+        if (failed != NULL) {
+            red("[Error] ");
+            printf("%s: The lexer returned bad tokens for this line: %s\n", argv[c], failed);
+            free(failed);
+            status = 1;
+        }
+
+        for (int i = 0; i < n; ++i) { free(lines[i]); }
+        free(lines);
+    }
+
+    if (status == 0) {
+        blue("[Info] ");
+        printf("Fuzzed the lexer with %li mutated lines, every one was lexed correctly\n", fuzzed);
+    }
+
+    free(times);
+    return status;
+}
+
+
+/**
+ * Generate a command line of about the given length, either of plain file names, e.g. "rm file0 file1...", or with
+ * quotes and escapes mixed in, e.g. "echo 'file 0' \"file\\ 1\"..."
+ *
+ * @param length Number of bytes in the line, not counting the NUL
+ * @param quoted 1 to mix in quotes and escapes
+ * @return The line, to be freed
+ */
+char *generateLine(size_t length, int quoted) {
+    char *line = malloc(length + 1);
+    size_t w = sprintf(line, quoted ? "echo" : "rm");
+
+    // Whole words while they fit, each is less than 32 bytes. Then a last word of x's makes up the length
+    for (int i = 0; w + 32 < length; ++i) {
+        if (!quoted) { w += sprintf(line + w, " file%i.txt", i); }
+        else if (i % 3 == 0) { w += sprintf(line + w, " 'file %i.txt'", i); }
+        else if (i % 3 == 1) { w += sprintf(line + w, " \"file\\ %i.txt\"", i); }
+        else { w += sprintf(line + w, " file\\ %i.txt", i); }
+    }
+
+    line[w++] = ' ';
+    memset(line + w, 'x', length - w);
+    line[length] = 0;
+
+    return line;
+}
+
+
+/**
+ * Time lexing lines from BENCH_LINES_SHORTEST to BENCH_LINES_LONGEST bytes, growing 10 times each step, both of plain
+ * words and with quotes mixed in. Long lines are mostly runs of plain characters, which scanPlain() finds with SIMD
+ *
+ * @param runs Number of times to lex each line
+ * @return 0
+ */
+int benchLines(int runs) {
+    double *times = malloc(runs * sizeof(double));
+
+    blue("[Info] ");
+    printf("Time to lex a line over %i runs, in microseconds\n", runs);
+    printf("%-10s %-8s %10s %10s %10s\n", "Length", "Words", "p50", "p99", "MB/s");
+
+    for (size_t length = BENCH_LINES_SHORTEST; length <= BENCH_LINES_LONGEST; length *= 10) {
+        for (int quoted = 0; quoted <= 1; ++quoted) {
+            char *line = generateLine(length, quoted);
+            char *buffer = malloc(length + 1);
+            char size[32];
+
+            if (length >= 1000000) { snprintf(size, sizeof(size), "%zuMB", length / 1000000); }
+            else if (length >= 1000) { snprintf(size, sizeof(size), "%zuKB", length / 1000); }
+            else { snprintf(size, sizeof(size), "%zuB", length); }
+
+            lexRuns(line, buffer, times, runs);
+            double p50 = percentile(times, runs, 0.5) / 1000;
+            printf("%-10s %-8s %10.2f %10.2f %10.1f\n", size, quoted ? "Quoted" : "Plain", p50,
+                   percentile(times, runs, 0.99) / 1000, length / p50);
+
+            free(buffer);
+            free(line);
+        }
+    }
+
+    free(times);
+    return 0;
+}
+
+
+/**
+ * Run each line of a corpus in this shell, as if it had been read from a script, timing each stage of every line
+ * Anything the commands print is thrown away, so that the terminal doesn't slow them down
+ *
+ * @param lines The commands to run, each ending in a newline
+ * @param n Number of commands
+ * @param rounds Number of times to run every command
+ * @param replay Filled in with the time taken by each line
+ */
+void replayBatch(char **lines, int n, int rounds, Replay *replay) {
+    char *command = NULL;
+    size_t commandSize = 0;
+    char *directory = strdup(getCwd()); // Commands may change directory, the next corpus starts from here again
+
+    fflush(stdout);
+    int output = dup(STDOUT_FILENO);
+    int nowhere = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    dup2(nowhere, STDOUT_FILENO);
+    close(nowhere);
+
+    long long replayStart = nanoseconds();
+
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < n; ++i) {
+            if (strlen(lines[i]) + 1 > commandSize) {
+                commandSize = strlen(lines[i]) + 1;
+                command = realloc(command, commandSize);
+            }
+            strcpy(command, lines[i]); // runLine() changes the line as it runs it
+
+            TimerStats before[TIMER_COUNT];
+            memcpy(before, timers, sizeof(timers));
+            long long start = nanoseconds();
+
+            runLine(&command, &commandSize);
+            notifyJobs();
+
+            for (int stage = 0; stage < TIMER_COUNT; ++stage) {
+                replay->times[stage][replay->count] = (timers[stage].nanoseconds - before[stage].nanoseconds) / 1000.0;
+            }
+            replay->times[LINE_TIME][replay->count++] = (nanoseconds() - start) / 1000.0;
+        }
+    }
+
+    replay->seconds = (nanoseconds() - replayStart) / 1000000000.0;
+
+    fflush(stdout);
+    dup2(output, STDOUT_FILENO);
+    close(output);
+
+    changeDirectory(directory);
+    free(directory);
+    free(command);
+}
+
+
+/**
+ * Type each line of a corpus into a new shell running in a pseudo-terminal, timing from the line being entered to the
+ * next prompt appearing. Each round starts a new shell
+ *
+ * @param lines The commands to run, each ending in a newline
+ * @param n Number of commands
+ * @param rounds Number of times to run every command
+ * @param replay Filled in with the time taken by each line, there is no time for each stage
+ * @return 0 on success, 1 if the shell stopped showing a prompt
+ */
+int replayTerminal(char **lines, int n, int rounds, Replay *replay) {
+    char *arguments[] = { "SimpleShell", NULL };
+    long long replayStart = nanoseconds();
+
+    for (int round = 0; round < rounds; ++round) {
+        pid_t pid;
+        int terminal = startInTerminal(arguments, &pid);
+        if (terminal < 0) { return 1; }
+
+        if (waitForPrompt(terminal, nanoseconds()) < 0) {
+            stopInTerminal(terminal, pid, 1);
+            return 1;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            drainTerminal(terminal); // e.g. the prompt being redrawn, so it isn't mistaken for the next one
+
+            // Typed in as a user would, ending with Enter
+            size_t length = strlen(lines[i]);
+            char *typed = strdup(lines[i]);
+            typed[length - 1] = '\r';
+
+            long long start = nanoseconds();
+            write(terminal, typed, length);
+            free(typed);
+
+            double time = waitForPrompt(terminal, start);
+            if (time < 0) {
+                stopInTerminal(terminal, pid, 1);
+                return 1;
+            }
+
+            for (int stage = 0; stage < TIMER_COUNT; ++stage) { replay->times[stage][replay->count] = 0; }
+            replay->times[LINE_TIME][replay->count++] = time * 1000;
+        }
+
+        stopInTerminal(terminal, pid, 0);
+    }
+
+    replay->seconds = (nanoseconds() - replayStart) / 1000000000.0;
+    return 0;
+}
+
+
+/**
+ * Work out the median time of each stage in the fastest round, which is what is compared against a baseline.
+ * Something else running on the machine can slow down a whole round, so the fastest round is much steadier from one
+ * replay to the next than every round taken together. Must be called before the times are sorted
+ *
+ * @param replay The replay
+ * @param rounds Number of rounds in the replay
+ */
+void fastestMedians(Replay *replay, int rounds) {
+    int perRound = replay->count / rounds;
+    double *round = malloc(perRound * sizeof(double));
+
+    for (int stage = 0; stage <= LINE_TIME; ++stage) {
+        for (int r = 0; r < rounds; ++r) {
+            memcpy(round, replay->times[stage] + r * perRound, perRound * sizeof(double));
+            sortTimes(round, perRound);
+
+            double median = percentile(round, perRound, 0.5);
+            if (r == 0 || median < replay->fastest[stage]) { replay->fastest[stage] = median; }
+        }
+    }
+
+    free(round);
+}
+
+
+/* Display the times for a replay, sorting them first */
+void reportReplay(Replay *replay, int terminal) {
+    blue("[Info] ");
+    printf("%s: %i lines, %.0f lines/s\n", replay->name, replay->count, replay->count / replay->seconds);
+    printf("    %-8s %10s %10s %10s\n", "", "p50", "p99", "fastest");
+
+    // Waiting for input doesn't come into a replay, and only whole lines are timed in a terminal
+    for (int stage = LINE_TIME; stage > TIMER_INPUT; --stage) {
+        if (terminal && stage != LINE_TIME) { continue; }
+
+        sortTimes(replay->times[stage], replay->count);
+        printf("    %-8s %8.2fus %8.2fus %8.2fus\n", stageName(stage), percentile(replay->times[stage], replay->count, 0.5),
+               percentile(replay->times[stage], replay->count, 0.99), replay->fastest[stage]);
+    }
+}
+
+
+/* Save the times for a replay to a baseline file, one line per stage as "<corpus>\t<stage>\t<fastest>" */
+void saveReplay(FILE *fp, Replay *replay, int terminal) {
+    for (int stage = LINE_TIME; stage > TIMER_INPUT; --stage) {
+        if (terminal && stage != LINE_TIME) { continue; }
+
+        fprintf(fp, "%s\t%s\t%.3f\n", replay->name, stageName(stage), replay->fastest[stage]);
+    }
+}
+
+
+/**
+ * Compare the times for a replay with a baseline saved by saveReplay(), reporting any stage whose median in the fastest
+ * round has grown by more than REPLAY_TOLERANCE. Stages missing from the baseline are skipped
+ *
+ * @param path The baseline file
+ * @param replay The replay
+ * @return The number of regressions found
+ */
+int compareReplay(char *path, Replay *replay) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) { return 0; }
+
+    char *line = NULL;
+    size_t size = 0;
+    int regressions = 0;
+
+    while (getline(&line, &size, fp) > 0) {
+        char *name = strtok(line, "\t");
+        char *stageText = strtok(NULL, "\t");
+        char *median = strtok(NULL, "\t\n");
+        if (line[0] == '#' || median == NULL || strcmp(name, replay->name) != 0) { continue; }
+
+        for (int stage = 0; stage <= LINE_TIME; ++stage) {
+            if (strcmp(stageText, stageName(stage)) != 0) { continue; }
+
+            double before = strtod(median, NULL);
+            double now = replay->fastest[stage];
+
+            if (now > before * REPLAY_TOLERANCE && now - before > REPLAY_MIN_US) {
+                yellow("[Warning] ");
+                printf("%s: %s is %.2fus, up from %.2fus in the baseline (+%.0f%%)\n", replay->name,
+                       stageName(stage), now, before, (now / before - 1) * 100);
+                regressions++;
+            }
+        }
+    }
+
+    free(line);
+    fclose(fp);
+    return regressions;
+}
+
+
+/* Remove a home directory made for a replay, along with the history and alias files the shell may have left there */
+void removeReplayHome(char *home) {
+    char path[MAX_PATH];
+
+    snprintf(path, sizeof(path), "%s/%s", home, HISTORY_FILE);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/.alias", home);
+    unlink(path);
+    rmdir(home);
+}
+
+
+/**
+ * Replay each corpus of commands given
+ *      --replay <corpus>... [--pty] [--rounds <n>] [--baseline <file>] [--save-baseline <file>]
+ *
+ * @param argc Number of arguments after --replay
+ * @param argv Arguments after --replay
+ * @return 0 on success, 1 on a regression against the baseline or if a corpus couldn't be replayed, 2 on bad usage
+ */
+int replayCommands(int argc, char const *argv[]) {
+    char const **corpora = malloc((argc + 1) * sizeof(char *));
+    int nCorpora = 0, rounds = REPLAY_ROUNDS, terminal = 0;
+    char *baseline = NULL, *saveTo = NULL;
+
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--pty") == 0) { terminal = 1; }
+        else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) { rounds = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) { baseline = (char *) argv[++i]; }
+        else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc) { saveTo = (char *) argv[++i]; }
+        else if (argv[i][0] != '-') { corpora[nCorpora++] = argv[i]; }
+        else { nCorpora = 0; break; }
+    }
+
+    if (nCorpora == 0 || rounds < 1) {
+        fprintf(stderr, "Usage: SimpleShell --replay <corpus>... [--pty] [--rounds <n>] [--baseline <file>] "
+                        "[--save-baseline <file>]\n");
+        free(corpora);
+        return 2;
+    }
+
+    // Replays keep history and aliases in a home directory of their own, so the users' own are left alone
+    char home[] = "/tmp/SimpleShell-replay-XXXXXX";
+    if (mkdtemp(home) == NULL) {
+        red("[Error] ");
+        printf("Unable to create a home directory for the replay: %s\n", strerror(errno));
+        free(corpora);
+        return 1;
+    }
+    setenv("HOME", home, 1);
+    keepHistory = 1;
+    initialiseJobs();
+
+    FILE *save = (saveTo != NULL) ? fopen(saveTo, "w") : NULL;
+    if (save != NULL) { fprintf(save, "# SimpleShell --replay baseline: corpus, stage, median of the fastest round in microseconds\n"); }
+
+    int status = 0;
+
+    for (int c = 0; c < nCorpora; ++c) {
+        int n;
+        char **lines = readCorpus((char *) corpora[c], &n);
+
+        if (lines == NULL || n == 0) {
+            red("[Error] ");
+            printf("Unable to read any commands from %s\n", corpora[c]);
+            status = 1;
+            continue;
+        }
+
+        Replay replay = { .count = 0 };
+        char *base = strrchr(corpora[c], '/');
+        snprintf(replay.name, sizeof(replay.name), "%s%s", base ? base + 1 : corpora[c], terminal ? " (pty)" : "");
+
+        for (int stage = 0; stage <= LINE_TIME; ++stage) { replay.times[stage] = malloc(n * rounds * sizeof(double)); }
+
+        int failed = 0;
+        if (terminal) { failed = replayTerminal(lines, n, rounds, &replay); }
+        else { replayBatch(lines, n, rounds, &replay); }
+
+        if (failed) {
+            red("[Error] ");
+            printf("%s: The shell stopped showing a prompt, after %i lines\n", corpora[c], replay.count);
+            status = 1;
+        } else {
+            fastestMedians(&replay, rounds);
+            reportReplay(&replay, terminal);
+            if (save != NULL) { saveReplay(save, &replay, terminal); }
+            if (baseline != NULL && compareReplay(baseline, &replay) > 0) { status = 1; }
+        }
+
+        for (int stage = 0; stage <= LINE_TIME; ++stage) { free(replay.times[stage]); }
+        for (int i = 0; i < n; ++i) { free(lines[i]); }
+        free(lines);
+    }
+
+    if (save != NULL) { fclose(save); }
+    if (saveTo != NULL && save == NULL) {
+        red("[Error] ");
+        printf("Unable to save the baseline to %s: %s\n", saveTo, strerror(errno));
+        status = 1;
+    }
+
+    hangupJobs();
+    removeReplayHome(home);
+    free(corpora);
+    return status;
+}
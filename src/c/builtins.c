@@ -0,0 +1,559 @@
+// Here we define the builtins, commands which are handled by the shell itself rather than run as a system command
+// Each builtin is registered in BUILTINS along with how many arguments it accepts, so that arguments can be checked
+// in one place. Builtins are found through a perfect hash table, so finding a builtin (Or finding that a command is not
+// a builtin) takes a single hash and at most one string comparison, however many builtins there are
+
+
+/* exit [status] - Exit the shell */
+int builtinExit(int n, char *tokens[]) {
+    if (n == 2) {
+        char *end;
+        long status = strtol(tokens[1], &end, 10);
+
+        if (*end != 0 || end == tokens[1] || status < INT_MIN || status > INT_MAX) {
+            red("[Error] ");
+            printf("\"%s\" is not a valid exit status. Try calling \"exit [status]\"\n", tokens[1]);
+            return 2;
+        }
+
+        lastStatus = status;
+    }
+
+    closeShell();
+    return lastStatus;
+}
+
+/* setpath <new path> - Set environmental PATH variable */
+int builtinSetPath(int n, char *tokens[]) {
+    (void) n;
+    return setPath(tokens[1]);
+}
+
+/* addpath <new path> - Append a directory to environmental PATH variable */
+int builtinAddPath(int n, char *tokens[]) {
+    (void) n;
+    return addPath(tokens[1]);
+}
+
+/* getpath - Display the current stage of environmental PATH variable */
+int builtinGetPath(int n, char *tokens[]) {
+    (void) n;
+    (void) tokens;
+    displayPath();
+    return 0;
+}
+
+/* sethome <new home dir> - Set the users' home directory */
+int builtinSetHome(int n, char *tokens[]) {
+    (void) n;
+    return setHome(tokens[1]);
+}
+
+/* gethome - Display the current users home directory */
+int builtinGetHome(int n, char *tokens[]) {
+    (void) n;
+    (void) tokens;
+    displayHome();
+    return 0;
+}
+
+/* getcwd - Display the current working directory */
+int builtinGetCwd(int n, char *tokens[]) {
+    (void) n;
+    (void) tokens;
+    displayCWD();
+    return 0;
+}
+
+/* cd [dir] - Change directory */
+int builtinCd(int n, char *tokens[]) {
+    (void) n;
+    return cd(tokens[1]);
+}
+
+/* history [-s <pattern>] - Display history to the user, or search all of history */
+int builtinHistory(int n, char *tokens[]) {
+    if (n == 1) {
+        dispHistory();
+        return 0;
+    }
+
+    if (n == 3 && strcmp(tokens[1], "-s") == 0) { return searchHistory(tokens[2]) > 0 ? 0 : 1; }
+
+    red("[Error] "); printf("\"history\" accepts no arguments, or -s <pattern>. Try calling \"history -s <pattern>\"\n");
+    return 2;
+}
+
+/* clearhistory - Clear all commands from history */
+int builtinClearHistory(int n, char *tokens[]) {
+    (void) n;
+    (void) tokens;
+    clearHistory();
+    return 0;
+}
+
+/* alias [<name> <command>] - Display all aliases' or add a new alias */
+int builtinAlias(int n, char *tokens[]) {
+    // Display all alias'
+    if (n == 1) {
+        dispAlias();
+        return 0;
+    }
+
+    // A name without a command
+    if (n == 2) {
+        red("[Error] "); printf("\"alias\" accepts zero or two (or more) arguments. Try calling \"alias\" or \"alias <name> <command>\"\n");
+        return 1;
+    }
+
+    // The command may be a history invocation, in which case the command from history is aliased
+    char *command = tokens[2];
+
+    if (*command == '!') {
+        int number = isHistory(command);
+        if (number > 0) {
+            command = getHistory(number);
+        } else if (number == -2) {
+            yellow("[Warning] ");
+            printf("\"%s\" is not a valid history invocation, adding anyway.\n", command);
+        }
+    }
+
+    // Join the command with its arguments (tokens[3:])
+    size_t length = strlen(command) + 1;
+    for (int i = 3; i < n; ++i) { length += strlen(tokens[i]) + 1; }
+
+    char *full = malloc(length);
+    strcpy(full, command);
+
+    for (int i = 3; i < n; ++i) {
+        strcat(full, " ");
+        strcat(full, tokens[i]);
+    }
+
+    int status = addAlias(tokens[1], full);
+    free(full);
+
+    return status;
+}
+
+/* unalias <command> - Remove an alias */
+int builtinUnalias(int n, char *tokens[]) {
+    (void) n;
+    return unAlias(tokens[1]);
+}
+
+/* hash [-r] - Display the command hash table, or clear it with "hash -r" */
+int builtinHash(int n, char *tokens[]) {
+    if (n == 1) {
+        dispHash();
+        return 0;
+    }
+
+    if (strcmp(tokens[1], "-r") != 0) {
+        red("[Error] "); printf("Unknown option \"%s\". Try calling \"hash\" or \"hash -r\"\n", tokens[1]);
+        return 1;
+    }
+
+    hashReset();
+    blue("[Info] "); printf("Command hash table cleared\n");
+    return 0;
+}
+
+/* launcher [fork|vfork|spawn|zygote] - Display or change how external commands are launched */
+int builtinLauncher(int n, char *tokens[]) {
+    if (n == 1) {
+        displayLaunchMode();
+        return 0;
+    }
+
+    return setLaunchMode(tokens[1]);
+}
+
+/* pipesize [bytes] - Display or set the capacity of pipes between commands in a pipeline */
+int builtinPipeSize(int n, char *tokens[]) {
+    if (n == 1) {
+        displayPipeSize();
+        return 0;
+    }
+
+    return setPipeSize(tokens[1]);
+}
+
+/* jobs - Display all jobs */
+int builtinJobs(int n, char *tokens[]) {
+    (void) n;
+    (void) tokens;
+    dispJobs();
+    return 0;
+}
+
+/* fg [%job] - Continue a job in the foreground */
+int builtinFg(int n, char *tokens[]) {
+    (void) n;
+    return foregroundJob(tokens[1]);
+}
+
+/* bg [%job] - Continue a stopped job in the background */
+int builtinBg(int n, char *tokens[]) {
+    (void) n;
+    return backgroundJob(tokens[1]);
+}
+
+/* wait [%job] - Wait for background jobs to finish */
+int builtinWait(int n, char *tokens[]) {
+    (void) n;
+    return waitJobs(tokens[1]);
+}
+
+/* parallel [-j workers] [-n args] <command> [::: <arg>...] - Run a command over many arguments at once */
+int builtinParallel(int n, char *tokens[]) {
+    return runParallel(n, tokens);
+}
+
+/* command <command> - Run the system command even if there is a builtin of the same name, e.g. "command echo" */
+int builtinCommand(int n, char *tokens[]) {
+    return runCommand(n - 1, &tokens[1], 1);
+}
+
+/* enable [-n] [name] - Turn a builtin back on, or off with -n so that the system command is run instead */
+int builtinEnable(int n, char *tokens[]) {
+    int disable = (n > 1 && strcmp(tokens[1], "-n") == 0);
+
+    if (n == 1 + disable) {
+        dispDisabledBuiltins();
+        return 0;
+    }
+
+    if (n == 3 && !disable) {
+        red("[Error] "); printf("Unknown option \"%s\". Try calling \"enable [-n] <builtin>\"\n", tokens[1]);
+        return 2;
+    }
+
+    char *name = tokens[n - 1];
+    Builtin *builtin = lookupBuiltin(name);
+
+    if (builtin == NULL) {
+        red("[Error] "); printf("\"%s\" is not a builtin. Try calling \"builtin -l\" to see every builtin\n", name);
+        return 1;
+    }
+
+    if (builtin->run == builtinEnable) {
+        red("[Error] "); printf("\"enable\" can't be disabled, as it couldn't be enabled again\n");
+        return 1;
+    }
+
+    builtin->disabled = disable;
+    blue("[Info] ");
+    if (disable) { printf("\"%s\" will now be run as a system command\n", name); }
+    else { printf("\"%s\" is a builtin again\n", name); }
+    return 0;
+}
+
+/* builtin -l - List every builtin */
+int builtinBuiltin(int n, char *tokens[]) {
+    if (n == 2 && strcmp(tokens[1], "-l") != 0) {
+        red("[Error] "); printf("Unknown option \"%s\". Try calling \"builtin -l\"\n", tokens[1]);
+        return 1;
+    }
+
+    dispBuiltins();
+    return 0;
+}
+
+/* shellstats [-r] - Display where time and memory have gone, or reset the counts */
+int builtinShellStats(int n, char *tokens[]) {
+    if (n == 1) {
+        dispStats();
+        return 0;
+    }
+
+    if (strcmp(tokens[1], "-r") == 0) {
+        resetStats();
+        blue("[Info] "); printf("Shell stats reset\n");
+        return 0;
+    }
+
+    red("[Error] "); printf("Unknown option \"%s\". Try calling \"shellstats\" or \"shellstats -r\"\n", tokens[1]);
+    return 1;
+}
+
+/* Seconds in a timeval */
+double seconds(struct timeval *time) {
+    return time->tv_sec + time->tv_usec / 1000000.0;
+}
+
+
+/**
+ * Subtract the resources in before from after, giving what was used in between
+ * The maximum resident set size can't be subtracted, so that of after is kept
+ */
+void subtractUsage(struct rusage *after, struct rusage *before) {
+    timersub(&after->ru_utime, &before->ru_utime, &after->ru_utime);
+    timersub(&after->ru_stime, &before->ru_stime, &after->ru_stime);
+
+    after->ru_minflt -= before->ru_minflt;
+    after->ru_majflt -= before->ru_majflt;
+    after->ru_inblock -= before->ru_inblock;
+    after->ru_oublock -= before->ru_oublock;
+    after->ru_nvcsw -= before->ru_nvcsw;
+    after->ru_nivcsw -= before->ru_nivcsw;
+}
+
+
+/**
+ * time [-j] <command> - Run a command, then report how long it took and the resources it used
+ * The report goes to stderr, so that it doesn't end up mixed in with the command's output
+ *
+ * System commands are measured with wait4(), adding up every process in the pipeline, so nothing but the command is
+ * counted. Builtins run inside the shell, so for those it is the shell's own usage while the builtin ran, along with
+ * any children it waited for, e.g. time wait
+ *
+ * @param n Number of tokens, including time
+ * @param tokens The tokens, starting with time. -j reports a single line of JSON, for reading by other programs
+ * @return The exit status of the command
+ */
+int builtinTime(int n, char *tokens[]) {
+    int json = (n > 1 && strcmp(tokens[1], "-j") == 0);
+    int first = 1 + json; // The command being timed
+
+    if (first >= n) {
+        red("[Error] "); printf("Nothing to time. Try calling \"time [-j] <command>\"\n");
+        return 2;
+    }
+
+    struct rusage self, children, usage;
+    int waited = jobsWaited;
+
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    long long started = nanoseconds();
+
+    int status = processCommand(n - first, &tokens[first]);
+
+    double real = (nanoseconds() - started) / 1000000000.0;
+
+    if (jobsWaited != waited) { // A system command
+        usage = lastJobUsage;
+    } else { // A builtin, or a command that couldn't be started
+        struct rusage childrenAfter;
+        getrusage(RUSAGE_SELF, &usage);
+        getrusage(RUSAGE_CHILDREN, &childrenAfter);
+
+        subtractUsage(&usage, &self);
+        subtractUsage(&childrenAfter, &children);
+        childrenAfter.ru_maxrss = 0; // Any child's, not necessarily one waited for by this builtin
+        addUsage(&usage, &childrenAfter);
+    }
+
+    fflush(stdout); // Show anything the command printed first
+
+    if (json) {
+        fprintf(stderr, "{\"command\": \"");
+        for (char *c = tokens[first]; *c != '\0'; ++c) { // Escaped, as it could contain quotes
+            if (*c == '"' || *c == '\\') { fprintf(stderr, "\\%c", *c); }
+            else if ((unsigned char) *c < ' ') { fprintf(stderr, "\\u%04x", *c); }
+            else { fputc(*c, stderr); }
+        }
+
+        fprintf(stderr, "\", \"status\": %i, \"real\": %.6f, \"user\": %.6f, \"sys\": %.6f, "
+                        "\"max_rss_kb\": %li, \"minor_faults\": %li, \"major_faults\": %li, \"voluntary_switches\": %li, "
+                        "\"involuntary_switches\": %li}\n",
+                status, real, seconds(&usage.ru_utime), seconds(&usage.ru_stime), usage.ru_maxrss,
+                usage.ru_minflt, usage.ru_majflt, usage.ru_nvcsw, usage.ru_nivcsw);
+    } else {
+        fprintf(stderr, "\nreal\t%.3fs\nuser\t%.3fs\nsys\t%.3fs\n", real, seconds(&usage.ru_utime), seconds(&usage.ru_stime));
+        fprintf(stderr, "max rss\t%li KB\nfaults\t%li minor, %li major\nswitches\t%li voluntary, %li involuntary\n",
+                usage.ru_maxrss, usage.ru_minflt, usage.ru_majflt, usage.ru_nvcsw, usage.ru_nivcsw);
+    }
+
+    return status;
+}
+
+
+Builtin BUILTINS[] = {
+    { "exit", 0, 1, "exit [status]", "Exit the shell", builtinExit, 0 },
+    { "setpath", 1, 1, "setpath <new path>", "Set the system path", builtinSetPath, 0 },
+    { "addpath", 1, 1, "addpath <new path>", "Append a directory to the system path", builtinAddPath, 0 },
+    { "getpath", 0, 0, "getpath", "Print the system path", builtinGetPath, 0 },
+    { "sethome", 1, 1, "sethome <new home dir>", "Set the home directory", builtinSetHome, 0 },
+    { "gethome", 0, 0, "gethome", "Print the home directory", builtinGetHome, 0 },
+    { "getcwd", 0, 0, "getcwd", "Print the current working directory", builtinGetCwd, 0 },
+    { "cd", 0, 1, "cd [dir]", "Change directory, by default to the home directory", builtinCd, 0 },
+    { "history", 0, 2, "history [-s <pattern>]", "Print the most recent commands, or search all of history", builtinHistory, 0 },
+    { "clearhistory", 0, 0, "clearhistory", "Clear all commands from history", builtinClearHistory, 0 },
+    { "alias", 0, -1, "alias [<name> <command>]", "Print all aliases, or add a new alias", builtinAlias, 0 },
+    { "unalias", 1, 1, "unalias <command>", "Remove an alias", builtinUnalias, 0 },
+    { "hash", 0, 1, "hash [-r]", "Print commands remembered from the path, or forget them all", builtinHash, 0 },
+    { "launcher", 0, 1, "launcher [fork|vfork|spawn|zygote]", "Print or set how system commands are launched", builtinLauncher, 0 },
+    { "pipesize", 0, 1, "pipesize [bytes]", "Print or set the capacity of pipes between commands", builtinPipeSize, 0 },
+    { "jobs", 0, 0, "jobs", "Print all background and stopped jobs", builtinJobs, 0 },
+    { "fg", 0, 1, "fg [%<job>]", "Continue a job in the foreground", builtinFg, 0 },
+    { "bg", 0, 1, "bg [%<job>]", "Continue a stopped job in the background", builtinBg, 0 },
+    { "wait", 0, 1, "wait [%<job>]", "Wait for background jobs to finish", builtinWait, 0 },
+    { "parallel", 1, -1, "parallel [-j workers] [-n args] <command> [::: <arg>...]", "Run a command over many arguments, several at once", builtinParallel, 0 },
+    { "builtin", 0, 1, "builtin -l", "Print every builtin", builtinBuiltin, 0 },
+    { "shellstats", 0, 1, "shellstats [-r]", "Print where time and memory have gone, or reset the counts", builtinShellStats, 0 },
+    { "enable", 0, 2, "enable [-n] [builtin]", "Turn a builtin off, so the system command is run instead, or back on", builtinEnable, 0 },
+    { "echo", 0, -1, "echo [-neE] [text...]", "Print text", builtinEcho, 0 },
+    { "printf", 1, -1, "printf <format> [argument...]", "Print the arguments as the format describes", builtinPrintf, 0 },
+    { "pwd", 0, 1, "pwd [-L|-P]", "Print the current working directory", builtinPwd, 0 },
+    { "true", 0, -1, "true", "Do nothing, successfully", builtinTrue, 0 },
+    { "false", 0, -1, "false", "Do nothing, unsuccessfully", builtinFalse, 0 },
+    { "test", 0, -1, "test <expression>", "Check a condition, e.g. test -f <file>", builtinTest, 0 },
+    { "[", 1, -1, "[ <expression> ]", "Check a condition, the same as test", builtinBracket, 0 },
+    { "sleep", 1, -1, "sleep <seconds>...", "Wait for a number of seconds, or with a suffix of m, h or d", builtinSleep, 0 },
+    { "command", 1, -1, "command <command>", "Run the system command, even if there is a builtin of the same name", builtinCommand, 0 },
+    { "time", 1, -1, "time [-j] <command>", "Run a command, then report how long it took and the resources it used", builtinTime, 0 },
+    { "kill", 1, -1, "kill [-s <signal>] <pid|%job>...", "Send a signal to processes or jobs, or list signals with -l", builtinKill, 0 },
+};
+
+Builtin *builtinTable[BUILTIN_TABLE_SIZE]; // Perfect hash table of BUILTINS, filled in by buildBuiltinTable()
+unsigned int builtinSeed = 0; // Seed that gives every builtin its own slot, 0 until the table has been built
+
+
+/* FNV-1a hash of a builtin name, mixed with a seed */
+unsigned int hashBuiltinName(char *name, unsigned int seed) {
+    unsigned int h = 2166136261u ^ seed;
+
+    while (*name) {
+        h ^= (unsigned char) *name++;
+        h *= 16777619u;
+    }
+
+    return h & (BUILTIN_TABLE_SIZE - 1);
+}
+
+
+/**
+ * Build a perfect hash table of the builtins, by trying seeds until one is found that gives every builtin a different
+ * slot. The table is a few times larger than the number of builtins, so only a handful of seeds need to be tried
+ */
+void buildBuiltinTable() {
+    int count = sizeof(BUILTINS) / sizeof(BUILTINS[0]);
+    int collision = 1;
+
+    for (builtinSeed = 1; collision; ++builtinSeed) {
+        collision = 0;
+        memset(builtinTable, 0, sizeof(builtinTable));
+
+        for (int i = 0; i < count && !collision; ++i) {
+            unsigned int slot = hashBuiltinName(BUILTINS[i].name, builtinSeed);
+
+            if (builtinTable[slot] != NULL) { collision = 1; }
+            else { builtinTable[slot] = &BUILTINS[i]; }
+        }
+
+        if (!collision) { return; }
+    }
+}
+
+
+/**
+ * Find a builtin by name, whether or not it has been disabled
+ * @param name The name of the builtin
+ * @return The builtin, or NULL if there is no such builtin
+ */
+Builtin *lookupBuiltin(char *name) {
+    if (builtinSeed == 0) { buildBuiltinTable(); }
+
+    Builtin *builtin = builtinTable[hashBuiltinName(name, builtinSeed)];
+
+    if (builtin != NULL && strcmp(builtin->name, name) == 0) { return builtin; }
+    return NULL;
+}
+
+
+/**
+ * Find a builtin to run
+ * @param name The command entered by the user, i.e. tokens[0]
+ * @return The builtin, or NULL if this is not a builtin or it has been disabled with "enable -n"
+ */
+Builtin *findBuiltin(char *name) {
+    Builtin *builtin = lookupBuiltin(name);
+    return (builtin != NULL && !builtin->disabled) ? builtin : NULL;
+}
+
+
+/**
+ * Check that a builtin has been given an acceptable number of arguments, displaying an error if not
+ * @param builtin The builtin being run
+ * @param args Number of arguments, not counting the name of the builtin
+ * @return 1 if the number of arguments is acceptable, 0 otherwise
+ */
+int checkArguments(Builtin *builtin, int args) {
+    if (args >= builtin->minArgs && (builtin->maxArgs < 0 || args <= builtin->maxArgs)) { return 1; }
+
+    red("[Error] ");
+    printf("\"%s\" ", builtin->name);
+
+    if (builtin->maxArgs == 0) {
+        printf("does not accept any arguments. Try calling \"%s\" by itself\n", builtin->name);
+    } else if (builtin->maxArgs < 0) {
+        printf("requires at least %i argument%s. Try calling \"%s\"\n", builtin->minArgs, builtin->minArgs == 1 ? "" : "s", builtin->usage);
+    } else if (builtin->minArgs == 0) {
+        printf("accepts at most %i argument%s. Try calling \"%s\"\n", builtin->maxArgs, builtin->maxArgs == 1 ? "" : "s", builtin->usage);
+    } else if (builtin->minArgs == builtin->maxArgs) {
+        printf("requires %i argument%s. Try calling \"%s\"\n", builtin->minArgs, builtin->minArgs == 1 ? "" : "s", builtin->usage);
+    } else {
+        printf("accepts between %i and %i arguments. Try calling \"%s\"\n", builtin->minArgs, builtin->maxArgs, builtin->usage);
+    }
+
+    return 0;
+}
+
+
+/**
+ * Run a builtin, first checking the number of arguments it has been given
+ *
+ * @param builtin The builtin to run
+ * @param n Number of tokens, including the name of the builtin
+ * @param tokens The name of the builtin followed by its arguments, NULL terminated
+ * @return The exit status of the builtin
+ */
+int runBuiltin(Builtin *builtin, int n, char *tokens[]) {
+    if (!checkArguments(builtin, n - 1)) { return 2; }
+
+    return builtin->run(n, tokens);
+}
+
+
+/**
+ * Builtins such as time and command run the rest of the line as a command of their own, so they are run before the line is split
+ * into a pipeline, and apply to the whole of it, e.g. "time make | tail"
+ * @param builtin The builtin to check
+ * @return 1 if the builtin takes a command
+ */
+int isPrefixBuiltin(Builtin *builtin) {
+    return builtin->run == builtinTime || builtin->run == builtinCommand;
+}
+
+
+/* Display every builtin, how to call it and what it does */
+void dispBuiltins() {
+    blue(" = Builtins Begin =\n");
+
+    for (int i = 0; i < (int) (sizeof(BUILTINS) / sizeof(BUILTINS[0])); ++i) {
+        printf(" %-30s%s%s\n", BUILTINS[i].usage, BUILTINS[i].description, BUILTINS[i].disabled ? " (Disabled)" : "");
+    }
+
+    blue(" = Builtins End =\n");
+}
+
+
+/* Display every builtin that has been disabled with "enable -n" */
+void dispDisabledBuiltins() {
+    int count = 0;
+
+    for (int i = 0; i < (int) (sizeof(BUILTINS) / sizeof(BUILTINS[0])); ++i) {
+        if (BUILTINS[i].disabled) {
+            printf("enable -n %s\n", BUILTINS[i].name);
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        blue("[Info] ");
+        printf("Every builtin is enabled\n");
+    }
+}
@@ -1,32 +1,39 @@
-void colourReset () {
-    printf("\033[0m");
+// Here we handle output to the terminal
+// stdout is fully buffered, so a prompt or a message is built up in the buffer and reaches the terminal in a single
+// write, when the shell next waits for input (see readLine()) or starts a command (see launchProcess())
+// Colours are only used when the user is typing commands in, stdout is a terminal and NO_COLOR isn't set
+
+char outputBuffer[OUTPUT_BUFFER]; // Buffer for stdout
+
+
+/* Buffer stdout and decide whether to use colour. Must be called before anything is printed to stdout */
+void initialiseOutput() {
+    char *noColour = getenv("NO_COLOR"); // See https://no-color.org
+
+    useColour = interactive && isatty(STDOUT_FILENO) && (noColour == NULL || noColour[0] == '\0');
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
 }
 
-void print(char* message) {
-    printf("%s", message);
+
+/* Print a message in colour, if colour is being used */
+void colour(char *code, char *message) {
+    if (useColour) { printf("%s%s" COLOUR_RESET, code, message); }
+    else { fputs(message, stdout); }
 }
 
 
 void red(char* message) {
-    printf("\033[1;31m");
-    print(message);
-    colourReset();
+    colour(COLOUR_RED, message);
 }
 
 void yellow(char* message) {
-    printf("\033[1;33m");
-    print(message);
-    colourReset();
+    colour(COLOUR_YELLOW, message);
 }
 
 void green(char* message) {
-    printf("\033[1;32m");
-    print(message);
-    colourReset();
+    colour(COLOUR_GREEN, message);
 }
 
 void blue(char* message) {
-    printf("\033[1;34m");
-    print(message);
-    colourReset();
-}
\ No newline at end of file
+    colour(COLOUR_BLUE, message);
+}
@@ -0,0 +1,635 @@
+// Here we complete the word before the cursor when Tab is pressed
+// The first word of a command, or the word after |, ;, &, && or ||, is completed from the builtins, the aliases (only
+// at the start of the line, where they are expanded) and the executables on PATH. Any other word, or a word with a / in
+// it, is completed from the files in its directory, e.g. src/c/e completes to src/c/editor.c, with a / added after a
+// directory. A word beginning with ~/ looks in the home directory. The text every candidate shares is added to the
+// line, escaped so that the lexer reads it back as it is. If that adds nothing, pressing Tab again lists the candidates.
+//
+// Executables on PATH are kept in one sorted index, so those beginning with what has been typed are found with a
+// binary search however many there are. The index is built by a thread in the background, started once the first
+// prompt is up and the first key is pressed so that it never holds the prompt up, then kept up to date by the same
+// thread with inotify: a file added to, removed from or made executable in a directory on PATH only changes that one
+// entry. Each entry has a bit for every directory it is in, so an executable in two directories stays until it has gone
+// from both. setpath and addpath have the index built again. Relative entries in PATH, e.g. ".", depend on the working
+// directory so are left out. Files are listed with listDirectory() (see glob.c), which caches each directory until it
+// changes, so pressing Tab again in the same directory doesn't read it again.
+
+#define INDEX_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+pthread_mutex_t indexLock = PTHREAD_MUTEX_INITIALIZER; // Guards pathCommands, indexPath and indexBuilt
+pthread_cond_t indexReady = PTHREAD_COND_INITIALIZER; // Signalled once the index has first been built
+int indexBuilt = 0; // 1 once the index has first been built
+PathCommand *pathCommands = NULL; // Every executable on PATH, sorted by name
+int pathCommandCount = 0; // Number of executables in pathCommands
+int pathCommandCapacity = 0; // Number that can be held before pathCommands has to grow
+char *indexPath = NULL; // PATH to be indexed next, set when PATH changes and taken by the index thread
+pthread_t indexThread; // Builds the index, then keeps it up to date
+int indexStarted = 0; // 1 once the index thread has been started, see startCompletion()
+int indexWake[2] = { -1, -1 }; // Pipe written to when PATH changes, to wake the index thread
+
+// Only used by the index thread
+char *indexedPath = NULL; // PATH the index was built from
+char *indexDirectories[COMPLETION_DIRECTORIES]; // Directories indexed, in the order they are in PATH
+int indexWatches[COMPLETION_DIRECTORIES]; // inotify watch for each directory, or -1 if it isn't watched
+int indexDirectoryCount = 0; // Number of directories indexed
+int indexNotify = -1; // inotify instance watching the directories, or -1 if inotify isn't available
+
+
+/* Order executables by name, for qsort() */
+int compareCommands(const void *a, const void *b) {
+    return strcmp(((PathCommand *) a)->name, ((PathCommand *) b)->name);
+}
+
+
+/* The name of the i'th entry of a sorted run, whose entries are size bytes apart and each begin with the name */
+#define RUN_NAME(names, size, i) (*(char **) ((char *) (names) + (size_t) (i) * (size)))
+
+
+/**
+ * Binary search a sorted run of entries, each beginning with a name, e.g. the index or a directory listing
+ * @param names The name of the first entry
+ * @param size Bytes from one entry to the next
+ * @param count Number of entries
+ * @param name The name, or the start of a name
+ * @param length Number of bytes of name to compare, strlen(name) + 1 to find that exact name
+ * @param after 0 for the first entry that doesn't sort before name, 1 for the first after every entry beginning with it
+ * @return Index of the entry
+ */
+int searchRun(char **names, size_t size, int count, const char *name, size_t length, int after) {
+    int low = 0;
+    int high = count;
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        int order = strncmp(RUN_NAME(names, size, middle), name, length);
+
+        if (order < 0 || (after && order == 0)) { low = middle + 1; }
+        else { high = middle; }
+    }
+
+    return low;
+}
+
+
+/* Find where a name belongs in the index, see searchRun(). The caller must hold indexLock */
+int searchCommands(const char *name, size_t length, int after) {
+    if (pathCommands == NULL) { return 0; }
+    return searchRun(&pathCommands[0].name, sizeof(PathCommand), pathCommandCount, name, length, after);
+}
+
+
+/* Return if an entry of a directory is a file that can be executed, in the same way as searchPath() decides */
+int indexable(int dir, GlobEntry *entry) {
+    struct stat info;
+
+    if (entry->type != DT_REG && entry->type != DT_LNK && entry->type != DT_UNKNOWN) { return 0; }
+    if (entry->type != DT_REG && (fstatat(dir, entry->name, &info, 0) != 0 || !S_ISREG(info.st_mode))) { return 0; }
+
+    return faccessat(dir, entry->name, X_OK, 0) == 0;
+}
+
+
+/**
+ * Build the index from scratch, then swap it in for the old one. Each directory is watched before it is read, so
+ * nothing added while it is being read is missed
+ *
+ * @param path The PATH to index, which is kept and freed by the next build
+ */
+void buildIndex(char *path) {
+    // A new inotify instance, so that no events are left over from the old directories
+    if (indexNotify >= 0) { close(indexNotify); }
+    indexNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    for (int i = 0; i < indexDirectoryCount; ++i) { free(indexDirectories[i]); }
+    indexDirectoryCount = 0;
+    free(indexedPath);
+    indexedPath = path;
+
+    PathCommand *commands = NULL;
+    int count = 0;
+    int capacity = 0;
+    char *copy = strdup(path);
+    char *rest = NULL;
+
+    for (char *dir = strtok_r(copy, ":", &rest); dir != NULL && indexDirectoryCount < COMPLETION_DIRECTORIES;
+         dir = strtok_r(NULL, ":", &rest)) {
+        if (dir[0] != '/') { continue; } // Relative to the working directory
+
+        int bit = indexDirectoryCount++;
+        indexDirectories[bit] = strdup(dir);
+        indexWatches[bit] = (indexNotify >= 0) ? inotify_add_watch(indexNotify, dir, INDEX_EVENTS) : -1;
+
+        DirListing listing;
+        int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) { continue; }
+
+        if (readListing(fd, &listing) == 0) {
+            for (int i = 0; i < listing.count; ++i) {
+                if (!indexable(fd, &listing.entries[i])) { continue; }
+
+                if (count == capacity) {
+                    capacity = (capacity == 0) ? 1024 : capacity * 2;
+                    commands = realloc(commands, capacity * sizeof(PathCommand));
+                }
+
+                commands[count].name = strdup(listing.entries[i].name);
+                commands[count++].directories = 1ULL << bit;
+            }
+
+            free(listing.names);
+            free(listing.entries);
+        }
+
+        close(fd);
+    }
+
+    free(copy);
+
+    // An executable in several directories becomes a single entry, with a bit for each
+    qsort(commands, count, sizeof(PathCommand), compareCommands);
+
+    int unique = 0;
+    for (int i = 0; i < count; ++i) {
+        if (unique > 0 && strcmp(commands[unique - 1].name, commands[i].name) == 0) {
+            commands[unique - 1].directories |= commands[i].directories;
+            free(commands[i].name);
+        } else {
+            commands[unique++] = commands[i];
+        }
+    }
+
+    pthread_mutex_lock(&indexLock);
+    PathCommand *old = pathCommands;
+    int oldCount = pathCommandCount;
+    pathCommands = commands;
+    pathCommandCount = unique;
+    pathCommandCapacity = capacity;
+    indexBuilt = 1;
+    pthread_cond_broadcast(&indexReady);
+    pthread_mutex_unlock(&indexLock);
+
+    for (int i = 0; i < oldCount; ++i) { free(old[i].name); }
+    free(old);
+}
+
+
+/**
+ * Check a single file in an indexed directory again, after inotify has said it changed, then add it to or remove it
+ * from the index
+ *
+ * @param bit The directory, its position in indexDirectories
+ * @param name Name of the file
+ */
+void updateCommand(int bit, char *name) {
+    char path[MAX_PATH];
+    struct stat info;
+
+    snprintf(path, sizeof(path), "%s/%s", indexDirectories[bit], name);
+    int executable = stat(path, &info) == 0 && S_ISREG(info.st_mode) && access(path, X_OK) == 0;
+
+    pthread_mutex_lock(&indexLock);
+
+    int slot = searchCommands(name, strlen(name) + 1, 0);
+    int present = slot < pathCommandCount && strcmp(pathCommands[slot].name, name) == 0;
+
+    if (executable && present) {
+        pathCommands[slot].directories |= 1ULL << bit;
+
+    } else if (executable) {
+        if (pathCommandCount == pathCommandCapacity) {
+            pathCommandCapacity = (pathCommandCapacity == 0) ? 1024 : pathCommandCapacity * 2;
+            pathCommands = realloc(pathCommands, pathCommandCapacity * sizeof(PathCommand));
+        }
+
+        memmove(pathCommands + slot + 1, pathCommands + slot, (pathCommandCount - slot) * sizeof(PathCommand));
+        pathCommands[slot].name = strdup(name);
+        pathCommands[slot].directories = 1ULL << bit;
+        pathCommandCount++;
+
+    } else if (present && (pathCommands[slot].directories &= ~(1ULL << bit)) == 0) {
+        free(pathCommands[slot].name);
+        memmove(pathCommands + slot, pathCommands + slot + 1, (pathCommandCount - slot - 1) * sizeof(PathCommand));
+        pathCommandCount--;
+    }
+
+    pthread_mutex_unlock(&indexLock);
+}
+
+
+/**
+ * Apply every change inotify has seen to the index
+ * If a directory itself has gone or been moved, or too many changes were made at once for inotify to keep them all,
+ * the index is built again instead
+ */
+void readEvents() {
+    char buffer[COMPLETION_EVENTS] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int rebuild = 0;
+    ssize_t got;
+
+    while ((got = read(indexNotify, buffer, sizeof(buffer))) > 0) {
+        for (char *at = buffer; at < buffer + got;) {
+            struct inotify_event *event = (struct inotify_event *) at;
+            at += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                rebuild = 1;
+                continue;
+            }
+
+            // The same directory may be in PATH twice, in which case it has the same watch both times
+            for (int i = 0; i < indexDirectoryCount && event->len > 0; ++i) {
+                if (indexWatches[i] == event->wd) { updateCommand(i, event->name); }
+            }
+        }
+    }
+
+    if (rebuild) { buildIndex(strdup(indexedPath)); }
+}
+
+
+/**
+ * The index thread, which builds the index whenever PATH changes and keeps it up to date in between
+ * It only ever waits on the wake pipe and inotify, and shares nothing with the shell apart from what indexLock guards
+ */
+void *indexWorker(void *unused) {
+    (void) unused;
+    for (;;) {
+        pthread_mutex_lock(&indexLock);
+        char *path = indexPath;
+        indexPath = NULL;
+        pthread_mutex_unlock(&indexLock);
+
+        if (path != NULL) { buildIndex(path); }
+
+        struct pollfd waiting[2] = { { indexWake[0], POLLIN, 0 }, { indexNotify, POLLIN, 0 } };
+        if (poll(waiting, (indexNotify >= 0) ? 2 : 1, -1) < 0 && errno != EINTR) { return NULL; }
+
+        if (waiting[0].revents != 0) {
+            char drain[64];
+            while (read(indexWake[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        if (indexNotify >= 0 && waiting[1].revents != 0) { readEvents(); }
+    }
+}
+
+
+/* Start the index thread, which builds the index of executables on PATH in the background. Only the first call does */
+void startCompletion() {
+    if (indexWake[0] >= 0 || pipe2(indexWake, O_CLOEXEC | O_NONBLOCK) != 0) { return; }
+
+    indexPath = strdup(getPath() != NULL ? getPath() : "");
+    indexStarted = (startThread(&indexThread, indexWorker) == 0);
+}
+
+
+/* PATH has changed, have the index thread build the index again from the new PATH */
+void completionPathChanged() {
+    if (!indexStarted) { return; }
+
+    pthread_mutex_lock(&indexLock);
+    free(indexPath);
+    indexPath = strdup(getPath() != NULL ? getPath() : "");
+    pthread_mutex_unlock(&indexLock);
+
+    write(indexWake[1], "", 1);
+}
+
+
+/**
+ * Find the start of the word before the cursor, and what sort of word it is
+ * @param editor The line editor
+ * @param quote Set to the quote the cursor is inside of, or 0
+ * @param command Set to 1 if the word is a command, rather than an argument or a file to redirect to
+ * @param first Set to 1 if the word is the first on the line, where aliases are expanded
+ * @return Byte offset of the start of the word
+ */
+size_t findWord(Editor *editor, char *quote, int *command, int *first) {
+    size_t start = 0;
+
+    *quote = 0;
+    *command = 1;
+    *first = 1;
+
+    for (size_t i = 0; i < editor->cursor; ++i) {
+        char c = editor->buffer[i];
+
+        if (*quote != 0) {
+            if (c == *quote) { *quote = 0; }
+            else if (c == '\\' && *quote == '"') { i++; }
+            continue;
+        }
+
+        if (c == '\'' || c == '"') { *quote = c; continue; }
+        if (c == '\\') { i++; continue; }
+        if (c != ' ' && c != '\t' && strchr("|&;<>", c) == NULL) { continue; }
+
+        // A word has ended, the word after it is an argument unless this one was time or command
+        if (i > start && *command) {
+            size_t length = i - start;
+            int prefix = (length == 4 && strncmp(editor->buffer + start, "time", 4) == 0)
+                         || (length == 7 && strncmp(editor->buffer + start, "command", 7) == 0);
+
+            *command = prefix;
+            *first = 0;
+        }
+
+        if (c == '<' || c == '>') { *command = 0; }
+        if (c == '|' || c == '&' || c == ';') { *command = 1; *first = 0; }
+
+        start = i + 1;
+    }
+
+    return start;
+}
+
+
+/* The word from start up to the cursor, as the lexer would read it, i.e. without quotes and backslashes */
+char *unquoteWord(Editor *editor, size_t start) {
+    char *word = malloc(editor->cursor - start + 1);
+    char *w = word;
+    char quote = 0;
+
+    for (size_t i = start; i < editor->cursor; ++i) {
+        char c = editor->buffer[i];
+
+        if (quote == 0 && (c == '\'' || c == '"')) { quote = c; continue; }
+        if (quote != 0 && c == quote) { quote = 0; continue; }
+        if (c == '\\' && quote != '\'' && i + 1 < editor->cursor) { c = editor->buffer[++i]; }
+
+        *w++ = c;
+    }
+
+    *w = '\0';
+    return word;
+}
+
+
+/**
+ * Add a candidate. Only the first COMPLETION_SHOWN candidates in order are kept, the rest are just counted
+ * @param found The candidates found so far
+ * @param name The candidate, which must not have been added already
+ */
+void addCandidate(Completions *found, char *name) {
+    if (found->count == 0) {
+        found->first = name;
+        found->common = strlen(name);
+    } else {
+        size_t i = 0;
+        while (i < found->common && name[i] == found->first[i]) { i++; }
+        while (i > 0 && ((unsigned char) found->first[i] & 0xC0) == 0x80) { i--; } // Don't split a UTF-8 character
+        found->common = i;
+    }
+
+    found->count++;
+
+    int i = found->shown;
+    if (i == COMPLETION_SHOWN && strcmp(name, found->names[i - 1]) > 0) { return; }
+    if (i == COMPLETION_SHOWN) { i--; }
+
+    for (; i > 0 && strcmp(name, found->names[i - 1]) < 0; --i) { found->names[i] = found->names[i - 1]; }
+    found->names[i] = name;
+    if (found->shown < COMPLETION_SHOWN) { found->shown++; }
+}
+
+
+/**
+ * Add every name in a sorted run beginning with the text typed
+ * Once COMPLETION_SHOWN have been added, the rest can't be among the first in order, so they are only counted. The
+ * prefix shared by a sorted run is the prefix shared by its first and last names, so only the last is looked at
+ *
+ * @param found The candidates found so far
+ * @param names The run, as the name of each entry...
+ * @param size ...with entries size bytes apart
+ * @param count Number of entries
+ * @param hidden 1 to include names beginning with ., which are otherwise left out
+ */
+void addRun(Completions *found, char **names, size_t size, int count, int hidden) {
+    int i = 0;
+
+    for (int added = 0; i < count && added < COMPLETION_SHOWN; ++i) {
+        char *name = RUN_NAME(names, size, i);
+        if (!hidden && name[0] == '.') { continue; }
+
+        addCandidate(found, name);
+        added++;
+    }
+
+    // Only hidden names have to be looked at one by one, otherwise the rest are counted all at once
+    int rest = 0;
+    char *last = NULL;
+
+    if (hidden && i < count) {
+        rest = count - i;
+        last = RUN_NAME(names, size, count - 1);
+    } else if (!hidden) {
+        for (; i < count; ++i) {
+            char *name = RUN_NAME(names, size, i);
+            if (name[0] != '.') { rest++; last = name; }
+        }
+    }
+
+    if (rest > 0) {
+        found->count += rest - 1;
+        addCandidate(found, last);
+    }
+}
+
+
+/**
+ * Find every builtin, alias and executable on PATH beginning with a word. The caller must hold indexLock
+ * @param found The candidates found
+ * @param word The word typed
+ * @param first 1 if the word is the first on the line, so aliases are included
+ */
+void findCommands(Completions *found, char *word, int first) {
+    size_t length = strlen(word);
+    int start = searchCommands(word, length, 0);
+    int end = searchCommands(word, length, 1);
+
+    if (end > start) { addRun(found, &pathCommands[start].name, sizeof(PathCommand), end - start, 1); }
+
+    // Builtins and aliases with the same name as an executable are only counted once
+    for (int i = 0; i < (int) (sizeof(BUILTINS) / sizeof(BUILTINS[0])); ++i) {
+        char *name = BUILTINS[i].name;
+        if (BUILTINS[i].disabled || strncmp(name, word, length) != 0) { continue; }
+
+        int slot = searchCommands(name, strlen(name) + 1, 0);
+        if (slot < pathCommandCount && strcmp(pathCommands[slot].name, name) == 0) { continue; }
+
+        addCandidate(found, name);
+    }
+
+    if (!first) { return; }
+    useAliases();
+
+    for (int i = 0; i < aliasSize; ++i) {
+        char *name = aliasTable[i].name;
+        if (name == NULL || strncmp(name, word, length) != 0 || findBuiltin(name) != NULL) { continue; }
+
+        int slot = searchCommands(name, strlen(name) + 1, 0);
+        if (slot < pathCommandCount && strcmp(pathCommands[slot].name, name) == 0) { continue; }
+
+        addCandidate(found, name);
+    }
+}
+
+
+/**
+ * Return if a name in a directory listing is a directory, or a link to one
+ * @param listing The listing, whose entries say what type most names are without having to look them up
+ * @param directory The directory listed, ending in /, or "" for the working directory
+ * @param name The name, from the listing
+ */
+int isDirectory(DirListing *listing, char *directory, char *name) {
+    unsigned char type = listing->entries[firstWithPrefix(listing, name, strlen(name) + 1)].type;
+    char path[MAX_PATH];
+    struct stat info;
+
+    if (type != DT_LNK && type != DT_UNKNOWN) { return type == DT_DIR; }
+
+    snprintf(path, sizeof(path), "%s%s", directory, name);
+    return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+
+/**
+ * Add text to the line at the cursor, escaped so that the lexer reads it back as it is
+ * @param editor The line editor
+ * @param text The text
+ * @param length Number of bytes of text
+ * @param quote The quote the cursor is inside of, or 0
+ */
+void insertEscaped(Editor *editor, char *text, size_t length, char quote) {
+    char *special = (quote == 0) ? WORD_SPECIAL : (quote == '"') ? DOUBLE_SPECIAL : "";
+
+    for (size_t i = 0; i < length; ++i) {
+        if (strchr(special, text[i]) != NULL) { insertByte(editor, '\\'); }
+        insertByte(editor, text[i]);
+    }
+}
+
+
+/**
+ * List the candidates below the line, in columns, then draw the prompt and the line again underneath
+ * @param editor The line editor
+ * @param found The candidates
+ * @param listing The listing of the directory the candidates are in, to show which are directories. NULL for commands
+ * @param directory The directory listed
+ */
+void listCompletions(Editor *editor, Completions *found, DirListing *listing, char *directory) {
+    int widest = 0;
+
+    for (int i = 0; i < found->shown; ++i) {
+        int width = textColumns(found->names[i], strlen(found->names[i]));
+        if (width > widest) { widest = width; }
+    }
+
+    int across = editor->columns / (widest + 3); // Room for a / and two spaces
+    if (across < 1) { across = 1; }
+    int rows = (found->shown + across - 1) / across;
+
+    // Leave the line as it is and start below it
+    moveCursor(editor, editor->promptWidth + textColumns(editor->shown, editor->shownLength));
+    emit(editor, "\n", 1);
+
+    for (int row = 0; row < rows; ++row) {
+        for (int i = row; i < found->shown; i += rows) {
+            char *name = found->names[i];
+            int slash = (listing != NULL && isDirectory(listing, directory, name));
+            int padding = widest + 3 - textColumns(name, strlen(name)) - slash;
+
+            emit(editor, name, strlen(name));
+            if (slash) { emit(editor, "/", 1); }
+            for (int column = 0; i + rows < found->shown && column < padding; ++column) { emit(editor, " ", 1); }
+        }
+
+        emit(editor, "\n", 1);
+    }
+
+    if (found->count > found->shown) { emitSequence(editor, "... and %li more\n", (long) (found->count - found->shown)); }
+
+    editor->screenCursor = 0;
+    refreshPrompt(editor, 1);
+}
+
+
+/**
+ * Complete the word before the cursor, see the top of this file
+ * If there is a single candidate it is added along with a space, or a / for a directory. Otherwise the text every
+ * candidate begins with is added, and if that adds nothing the terminal beeps, or with list the candidates are shown
+ *
+ * @param editor The line editor
+ * @param list 1 if Tab has been pressed more than once in a row, to list the candidates
+ */
+void completeWord(Editor *editor, int list) {
+    long long started = nanoseconds();
+    char quote;
+    int command, first;
+    size_t start = findWord(editor, &quote, &command, &first);
+    char *word = unquoteWord(editor, start);
+    char *slash = strrchr(word, '/');
+    char *prefix = word;
+    char directory[MAX_PATH] = "";
+    DirListing *listing = NULL;
+    Completions found = { 0 };
+
+    if (command && slash == NULL) {
+        startCompletion(); // Tab may be the first key pressed, in which case wait for the index to be built
+        pthread_mutex_lock(&indexLock); // The index thread may free the names, so hold it until they are used
+        while (indexStarted && !indexBuilt) { pthread_cond_wait(&indexReady, &indexLock); }
+        findCommands(&found, word, first);
+
+    } else {
+        if (slash != NULL) {
+            prefix = slash + 1;
+            if (word[0] == '~' && word[1] == '/' && getHome() != NULL) {
+                snprintf(directory, sizeof(directory), "%s%.*s", getHome(), (int) (prefix - word - 1), word + 1);
+            } else {
+                snprintf(directory, sizeof(directory), "%.*s", (int) (prefix - word), word);
+            }
+        }
+
+        listing = listDirectory(directory);
+
+        if (listing != NULL) {
+            size_t length = strlen(prefix);
+            int start = firstWithPrefix(listing, prefix, length);
+            int end = searchRun(&listing->entries[0].name, sizeof(GlobEntry), listing->count, prefix, length, 1);
+
+            // Only an empty word can match hidden names without asking for them
+            addRun(&found, &listing->entries[start].name, sizeof(GlobEntry), end - start, length > 0);
+        }
+    }
+
+    size_t typed = strlen(prefix);
+
+    if (found.count == 1) {
+        insertEscaped(editor, found.first + typed, found.common - typed, quote);
+
+        if (listing != NULL && isDirectory(listing, directory, found.first)) {
+            insertByte(editor, '/');
+        } else {
+            if (quote != 0) { insertByte(editor, quote); }
+            insertByte(editor, ' ');
+        }
+
+        editor->tabs = 0; // Finished with this word, so Tab starts afresh on the next
+
+    } else if (found.common > typed) {
+        insertEscaped(editor, found.first + typed, found.common - typed, quote);
+        emit(editor, "\a", 1);
+
+    } else if (found.count > 1 && list) {
+        listCompletions(editor, &found, listing, directory);
+
+    } else {
+        emit(editor, "\a", 1);
+    }
+
+    if (listing != NULL) { releaseListing(listing); }
+    if (command && slash == NULL) { pthread_mutex_unlock(&indexLock); }
+    free(word);
+
+    stopTimer(TIMER_COMPLETE, started);
+}
@@ -0,0 +1,577 @@
+// Here we read commands typed in at the terminal, letting the user edit them before they are run
+// The terminal is put into raw mode while a line is read, so that each key reaches the shell as it is pressed. Keys
+// are handled as they arrive, then the line is redrawn. Only what has changed since the last redraw is sent, built up
+// and written all at once, so each keystroke costs a single write however slow the connection to the terminal is.
+// When several keys arrive together (e.g. pasted text), they are all handled before anything is redrawn.
+//
+//      Left/Right, Ctrl-B/Ctrl-F   Move the cursor               Alt-B/Alt-F         Move the cursor by a word
+//      Home/End, Ctrl-A/Ctrl-E     Start/end of the line         Backspace/Delete    Delete a character
+//      Up/Down, Ctrl-P/Ctrl-N      Move through history          Ctrl-K/Ctrl-U       Delete to the end/start
+//      Ctrl-R                      Search history                Ctrl-W              Delete the word before the cursor
+//      Ctrl-L                      Clear the screen              Ctrl-C              Abandon the line
+//      Tab                         Complete the word, press again to list the candidates, see completion.c
+//      Ctrl-D                      Exit on an empty line, otherwise delete the character under the cursor
+
+#define KEY_UP 1000 /* Keys sent as escape sequences, numbered above any single byte */
+#define KEY_DOWN 1001
+#define KEY_LEFT 1002
+#define KEY_RIGHT 1003
+#define KEY_HOME 1004
+#define KEY_END 1005
+#define KEY_DELETE 1006
+#define KEY_WORD_LEFT 1007
+#define KEY_WORD_RIGHT 1008
+#define KEY_NONE 1009 /* An escape sequence we don't handle */
+#define KEY_REFRESH 1010 /* Not a key, a prompt segment has fresh data so the prompt may need redrawing */
+
+struct termios cookedTerminal; // Terminal settings used while commands run, the line editor uses raw mode
+int haveCooked = 0; // 1 once cookedTerminal has been saved
+
+volatile sig_atomic_t terminalResized = 1; // Set when the terminal changes size, so its width is only looked up then
+int terminalWidth = 80; // Number of columns in the terminal
+
+char editorInput[256]; // Bytes read from the terminal but not yet handled
+size_t inputStart = 0; // Next byte to be handled
+size_t inputEnd = 0; // End of the bytes read
+
+
+/**
+ * Get the next byte typed, reading more from the terminal if every byte read so far has been handled
+ * While waiting, fresh data for the prompt can also wake us up, see segmentsFd()
+ *
+ * @param refresh 1 to return KEY_REFRESH if there is fresh data for the prompt, 0 in the middle of an escape sequence
+ * @return The byte, KEY_REFRESH, or -1 at the end of input
+ */
+int nextByte(int refresh) {
+    while (inputStart == inputEnd) {
+        struct pollfd waiting[2] = { { STDIN_FILENO, POLLIN, 0 }, { segmentsFd(), POLLIN, 0 } };
+
+        // Nothing is worked out in the background until the prompt needs it, until then just read
+        if (refresh && waiting[1].fd >= 0) {
+            if (poll(waiting, 2, -1) < 0 && errno != EINTR) { return -1; }
+
+            if (waiting[1].revents != 0) {
+                segmentsDrain();
+                return KEY_REFRESH;
+            }
+
+            if (waiting[0].revents == 0) { continue; }
+        }
+
+        ssize_t count = read(STDIN_FILENO, editorInput, sizeof(editorInput));
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { return -1; }
+
+        inputStart = 0;
+        inputEnd = count;
+    }
+
+    return (unsigned char) editorInput[inputStart++];
+}
+
+
+/**
+ * Get the next key pressed, turning escape sequences such as those sent by arrow keys into a single key
+ * @return A byte, one of the KEY_ values, or -1 at the end of input
+ */
+int readKey() {
+    int c = nextByte(1);
+    if (c != '\33') { return c; }
+
+    c = nextByte(0);
+    if (c == 'b' || c == 'B') { return KEY_WORD_LEFT; } // Alt-B
+    if (c == 'f' || c == 'F') { return KEY_WORD_RIGHT; } // Alt-F
+    if (c != '[' && c != 'O') { return (c < 0) ? -1 : KEY_NONE; }
+
+    // Either a letter, e.g. \33[A for up, or a number followed by ~, e.g. \33[3~ for delete
+    int number = 0;
+    for (c = nextByte(0); c >= '0' && c <= '9'; c = nextByte(0)) { number = number * 10 + c - '0'; }
+    while (c == ';' || (c >= '0' && c <= '9')) { c = nextByte(0); } // Modifiers, e.g. \33[1;5C, are ignored
+
+    switch (c) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'C': return KEY_RIGHT;
+        case 'D': return KEY_LEFT;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+        case '~':
+            if (number == 1 || number == 7) { return KEY_HOME; }
+            if (number == 4 || number == 8) { return KEY_END; }
+            if (number == 3) { return KEY_DELETE; }
+            return KEY_NONE;
+        case -1: return -1;
+        default: return KEY_NONE;
+    }
+}
+
+
+/**
+ * Number of columns text takes up on screen
+ * Each character takes up one column, characters made up of several bytes (UTF-8) are only counted once
+ *
+ * @param text The text
+ * @param length Number of bytes of text
+ * @return The number of columns
+ */
+int textColumns(char *text, size_t length) {
+    int columns = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        if (((unsigned char) text[i] & 0xC0) != 0x80) { columns++; }
+    }
+
+    return columns;
+}
+
+
+/* Add bytes to what will be written to the terminal */
+void emit(Editor *editor, char *text, size_t length) {
+    if (editor->outLength + length > editor->outCapacity) {
+        editor->outCapacity = (editor->outLength + length) * 2;
+        editor->out = realloc(editor->out, editor->outCapacity);
+    }
+
+    memcpy(editor->out + editor->outLength, text, length);
+    editor->outLength += length;
+}
+
+
+/* Add an escape sequence taking a single number to what will be written to the terminal, e.g. \33[3D */
+void emitSequence(Editor *editor, char *format, long number) {
+    char sequence[32];
+    int length = snprintf(sequence, sizeof(sequence), format, number);
+
+    emit(editor, sequence, length);
+}
+
+
+/* Write everything built up for this keystroke to the terminal at once */
+void flushEditor(Editor *editor) {
+    size_t written = 0;
+
+    while (written < editor->outLength) {
+        ssize_t count = write(STDOUT_FILENO, editor->out + written, editor->outLength - written);
+
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+
+        written += count;
+    }
+
+    editor->outLength = 0;
+}
+
+
+/**
+ * Move the terminal's cursor, using relative movements so that it works wherever the prompt is on screen
+ * @param editor The line editor
+ * @param to Column to move to, counting from the start of the prompt. Lines longer than the terminal wrap onto the
+ *           rows below
+ */
+void moveCursor(Editor *editor, size_t to) {
+    size_t from = editor->screenCursor;
+    long rows = (long) (to / editor->columns) - (long) (from / editor->columns);
+    long across = (long) (to % editor->columns) - (long) (from % editor->columns);
+
+    if (rows < 0) { emitSequence(editor, "\33[%liA", -rows); }
+    if (rows > 0) { emitSequence(editor, "\33[%liB", rows); }
+    if (across > 0) { emitSequence(editor, "\33[%liC", across); }
+    if (across < 0) { emitSequence(editor, "\33[%liD", -across); }
+
+    editor->screenCursor = to;
+}
+
+
+/**
+ * Bring the screen up to date with the line being edited
+ * Whatever is already on screen is left alone, only the text from the first change onwards is redrawn
+ */
+void repaint(Editor *editor) {
+    char *label = NULL; // Shown in front of the line during a search
+    int labelLength = 0;
+
+    if (editor->searching) {
+        char *failed = (editor->match == 0 && editor->queryLength > 0) ? "failed " : "";
+        labelLength = asprintf(&label, "(%sreverse-i-search)`%.*s': ", failed, (int) editor->queryLength,
+                               editor->query ? editor->query : "");
+    }
+
+    // What should be on screen. Control characters, e.g. tabs in a command from history, are shown as spaces
+    size_t length = labelLength + editor->length;
+    char *display = malloc(length + 1);
+
+    if (labelLength > 0) { memcpy(display, label, labelLength); }
+    for (size_t i = 0; i < editor->length; ++i) {
+        display[labelLength + i] = ((unsigned char) editor->buffer[i] < ' ') ? ' ' : editor->buffer[i];
+    }
+    free(label);
+
+    size_t same = 0;
+    while (same < length && same < editor->shownLength && display[same] == editor->shown[same]) { same++; }
+
+    if (same < length || same < editor->shownLength) {
+        moveCursor(editor, editor->promptWidth + textColumns(display, same));
+        emit(editor, display + same, length - same);
+        editor->screenCursor = editor->promptWidth + textColumns(display, length);
+
+        // A line ending on the last column leaves the cursor there rather than on the next row, so move it there
+        if (same < length && editor->screenCursor % editor->columns == 0) { emit(editor, "\n", 1); }
+
+        // Clear anything left over from a longer line
+        if (textColumns(editor->shown, editor->shownLength) > textColumns(display, length)) { emit(editor, "\33[J", 3); }
+    }
+
+    moveCursor(editor, editor->promptWidth + textColumns(display, labelLength + editor->cursor));
+
+    free(editor->shown);
+    editor->shown = display;
+    editor->shownLength = length;
+}
+
+
+/**
+ * Draw the prompt again if it has changed, e.g. when the git status has been worked out, followed by the line
+ * @param editor The line editor
+ * @param force 1 to draw it even if it hasn't changed
+ */
+void refreshPrompt(Editor *editor, int force) {
+    int columns;
+    char *prompt = buildPrompt(&columns);
+
+    if (!force && strcmp(prompt, editor->promptText) == 0) { return; }
+
+    // Go back to the start of the prompt, then draw it and clear what was after it. The line is drawn again by repaint()
+    moveCursor(editor, 0);
+    emit(editor, prompt, strlen(prompt));
+    emit(editor, "\33[J", 3);
+
+    free(editor->promptText);
+    editor->promptText = strdup(prompt);
+    editor->promptWidth = columns;
+    editor->screenCursor = columns;
+    editor->shownLength = 0;
+
+    if (columns > 0 && columns % editor->columns == 0) { emit(editor, "\n", 1); } // See repaint()
+}
+
+
+/* Replace the line being edited, leaving the cursor at the end */
+void setLine(Editor *editor, char *text) {
+    size_t length = strlen(text);
+
+    if (length + 1 > editor->capacity) {
+        editor->capacity = length + 1;
+        editor->buffer = realloc(editor->buffer, editor->capacity);
+    }
+
+    memcpy(editor->buffer, text, length + 1);
+    editor->length = editor->cursor = length;
+}
+
+
+/* Insert a byte at the cursor */
+void insertByte(Editor *editor, char c) {
+    if (editor->length + 2 > editor->capacity) {
+        editor->capacity *= 2;
+        editor->buffer = realloc(editor->buffer, editor->capacity);
+    }
+
+    memmove(editor->buffer + editor->cursor + 1, editor->buffer + editor->cursor, editor->length - editor->cursor + 1);
+    editor->buffer[editor->cursor++] = c;
+    editor->length++;
+}
+
+
+/* Remove the bytes from start up to end, moving the cursor to start */
+void removeText(Editor *editor, size_t start, size_t end) {
+    memmove(editor->buffer + start, editor->buffer + end, editor->length - end + 1);
+    editor->length -= end - start;
+    editor->cursor = start;
+}
+
+
+/* Start of the character before position i, skipping over the rest of a UTF-8 character */
+size_t previousCharacter(Editor *editor, size_t i) {
+    if (i > 0) { i--; }
+    while (i > 0 && ((unsigned char) editor->buffer[i] & 0xC0) == 0x80) { i--; }
+    return i;
+}
+
+
+/* Start of the character after position i */
+size_t nextCharacter(Editor *editor, size_t i) {
+    if (i < editor->length) { i++; }
+    while (i < editor->length && ((unsigned char) editor->buffer[i] & 0xC0) == 0x80) { i++; }
+    return i;
+}
+
+
+/* Start of the word before position i */
+size_t previousWord(Editor *editor, size_t i) {
+    while (i > 0 && editor->buffer[i - 1] == ' ') { i--; }
+    while (i > 0 && editor->buffer[i - 1] != ' ') { i--; }
+    return i;
+}
+
+
+/* End of the word after position i */
+size_t nextWord(Editor *editor, size_t i) {
+    while (i < editor->length && editor->buffer[i] == ' ') { i++; }
+    while (i < editor->length && editor->buffer[i] != ' ') { i++; }
+    return i;
+}
+
+
+/**
+ * Show a different command from history in place of the line being edited
+ * The line the user was typing is kept, and comes back after moving past the most recent command
+ *
+ * @param editor The line editor
+ * @param up 1 to move to an older command, 0 to move to a more recent one
+ */
+void recallHistory(Editor *editor, int up) {
+    int last = historyLength();
+
+    if (up) {
+        int number = (editor->recall == 0) ? last : editor->recall - 1;
+        if (number < 1) { return; }
+
+        if (editor->recall == 0) {
+            free(editor->saved);
+            editor->saved = strdup(editor->buffer);
+        }
+
+        editor->recall = number;
+        setLine(editor, getHistory(number));
+
+    } else if (editor->recall != 0) {
+        editor->recall = (editor->recall < last) ? editor->recall + 1 : 0;
+        setLine(editor, (editor->recall == 0) ? editor->saved : getHistory(editor->recall));
+    }
+}
+
+
+/**
+ * Search history for the most recent command containing the query, older than before
+ * The command found is shown with the cursor at the start of the match. If there is no match, the line is left alone
+ */
+void searchEditor(Editor *editor, int before) {
+    editor->query[editor->queryLength] = '\0';
+    editor->match = (editor->queryLength == 0) ? 0 : findHistory(editor->query, 0, before);
+
+    if (editor->match > 0) {
+        setLine(editor, getHistory(editor->match));
+        editor->cursor = strstr(editor->buffer, editor->query) - editor->buffer;
+    }
+}
+
+
+/**
+ * Handle a key pressed during a reverse search (Ctrl-R)
+ * Typing adds to the search, Ctrl-R finds the next older match, Ctrl-G abandons the search. Any other key keeps the
+ * command found and is then handled as normal
+ *
+ * @return 1 if the key has been handled, 0 if the search has finished and the key should be handled as normal
+ */
+int searchKey(Editor *editor, int key) {
+    int newest = historyLength() + 1; // Search everything
+
+    if (key == 18) { // Ctrl-R
+        if (editor->match > 0) { searchEditor(editor, editor->match); }
+
+    } else if (key == 127 || key == 8) { // Backspace, search again from the most recent command
+        if (editor->queryLength > 0) { editor->queryLength--; }
+        searchEditor(editor, newest);
+        if (editor->queryLength == 0) { setLine(editor, editor->saved); }
+
+    } else if (key == 7 || key == 3) { // Ctrl-G or Ctrl-C, put back the line from before the search
+        editor->searching = 0;
+        setLine(editor, editor->saved);
+
+    } else if (key >= ' ' && key < 256 && key != 127) { // The current match may still match, so include it
+        editor->query = realloc(editor->query, editor->queryLength + 2);
+        editor->query[editor->queryLength++] = key;
+        searchEditor(editor, (editor->match > 0) ? editor->match + 1 : newest);
+
+    } else {
+        editor->searching = 0;
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/**
+ * Handle a key
+ * @return 0 to carry on reading keys, 1 when the line has been entered, 2 if it was abandoned (Ctrl-C) and -1 to exit
+ *         (Ctrl-D on an empty line)
+ */
+int editKey(Editor *editor, int key) {
+    if (key == KEY_REFRESH) { refreshPrompt(editor, 0); return 0; } // Carries on with a search too
+    if (editor->searching && searchKey(editor, key)) { return 0; }
+
+    editor->tabs = (key == 9) ? editor->tabs + 1 : 0;
+
+    switch (key) {
+        case '\r': case '\n': return 1;
+        case 3: return 2; // Ctrl-C
+        case 4: // Ctrl-D
+            if (editor->length == 0) { return -1; }
+            removeText(editor, editor->cursor, nextCharacter(editor, editor->cursor));
+            break;
+        case KEY_DELETE: removeText(editor, editor->cursor, nextCharacter(editor, editor->cursor)); break;
+        case 127: case 8: removeText(editor, previousCharacter(editor, editor->cursor), editor->cursor); break; // Backspace
+        case 1: case KEY_HOME: editor->cursor = 0; break; // Ctrl-A
+        case 5: case KEY_END: editor->cursor = editor->length; break; // Ctrl-E
+        case 2: case KEY_LEFT: editor->cursor = previousCharacter(editor, editor->cursor); break; // Ctrl-B
+        case 6: case KEY_RIGHT: editor->cursor = nextCharacter(editor, editor->cursor); break; // Ctrl-F
+        case KEY_WORD_LEFT: editor->cursor = previousWord(editor, editor->cursor); break;
+        case KEY_WORD_RIGHT: editor->cursor = nextWord(editor, editor->cursor); break;
+        case 11: removeText(editor, editor->cursor, editor->length); break; // Ctrl-K
+        case 21: removeText(editor, 0, editor->cursor); break; // Ctrl-U
+        case 23: removeText(editor, previousWord(editor, editor->cursor), editor->cursor); break; // Ctrl-W
+        case 16: case KEY_UP: recallHistory(editor, 1); break; // Ctrl-P
+        case 14: case KEY_DOWN: recallHistory(editor, 0); break; // Ctrl-N
+        case 9: completeWord(editor, editor->tabs > 1); break; // Tab
+
+        case 18: // Ctrl-R, start a search, keeping the line in case it is abandoned
+            editor->searching = 1;
+            editor->queryLength = 0;
+            editor->match = 0;
+            free(editor->saved);
+            editor->saved = strdup(editor->buffer);
+            break;
+
+        case 12: // Ctrl-L, clear the screen then draw the prompt and the line again
+            emit(editor, CLEAR_SCREEN, strlen(CLEAR_SCREEN));
+            editor->screenCursor = 0;
+            refreshPrompt(editor, 1);
+            break;
+
+        default: // Anything else which isn't a control character is typed into the line
+            if (key >= ' ' && key < 256 && key != 127) { insertByte(editor, key); }
+    }
+
+    return 0;
+}
+
+
+/* SIGWINCH handler, the terminal has changed size */
+void terminalResize(int signal) {
+    (void) signal;
+    terminalResized = 1;
+}
+
+
+/* Number of columns in the terminal */
+int terminalColumns() {
+    struct winsize size;
+
+    if (terminalResized) {
+        terminalResized = 0;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) { terminalWidth = size.ws_col; }
+    }
+
+    return terminalWidth;
+}
+
+
+/* Display the prompt and read a line without editing, for when the terminal can't be put into raw mode */
+ssize_t readPlain(char **line, size_t *size) {
+    int columns;
+
+    fputs(buildPrompt(&columns), stdout);
+    fflush(stdout);
+
+    return getline(line, size, stdin);
+}
+
+
+/**
+ * Display the prompt, then read a line from the terminal, letting the user edit it and recall commands from history as
+ * they type. If the terminal can't be put into raw mode, the line is read without editing
+ *
+ * @param line Set to the line read, ending in a newline. Grown as needed, like getline()
+ * @param size Size of line
+ * @return The number of bytes read, including the newline, or -1 at the end of input
+ */
+ssize_t readLine(char **line, size_t *size) {
+    fflush(stdout); // Anything already printed has to reach the screen before anything the editor writes
+
+    // Commands may leave the terminal in any state, so the settings from when the shell started are used every time
+    if (!haveCooked && tcgetattr(STDIN_FILENO, &cookedTerminal) == 0) {
+        struct sigaction resize = { .sa_handler = terminalResize, .sa_flags = SA_RESTART };
+        sigaction(SIGWINCH, &resize, NULL);
+        haveCooked = 1;
+    }
+    if (!haveCooked) { return readPlain(line, size); }
+
+    struct termios raw = cookedTerminal;
+    raw.c_iflag &= ~(ICRNL | IXON);
+    raw.c_lflag &= ~(ICANON | ECHO | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0) { return readPlain(line, size); }
+
+    Editor editor = { 0 };
+    editor.capacity = 128;
+    editor.buffer = malloc(editor.capacity);
+    editor.buffer[0] = '\0';
+    editor.columns = terminalColumns();
+
+    refreshPrompt(&editor, 1);
+    flushEditor(&editor);
+
+    int done = 0;
+    while (done == 0) {
+        int key = readKey();
+        done = (key < 0) ? -1 : editKey(&editor, key);
+
+        // Index PATH for Tab once the user starts typing, so that it never holds up the prompt, see completion.c
+        if (done == 0 && key != KEY_REFRESH) { startCompletion(); }
+
+        if (done == 0 && inputStart == inputEnd) {
+            repaint(&editor);
+            flushEditor(&editor);
+        }
+    }
+
+    // Leave the cursor after the line, so that anything the command prints starts on a new row
+    editor.searching = 0;
+    repaint(&editor);
+    moveCursor(&editor, editor.promptWidth + textColumns(editor.shown, editor.shownLength));
+
+    if (done == 2) { emit(&editor, "^C", 2); }
+    if (done == 2 || (done == 1 && (editor.screenCursor % editor.columns != 0 || editor.length == 0))) { emit(&editor, "\n", 1); }
+
+    flushEditor(&editor);
+    tcsetattr(STDIN_FILENO, TCSANOW, &cookedTerminal);
+
+    ssize_t length = -1;
+
+    if (done != -1) {
+        if (done == 2) { editor.length = 0; } // An abandoned line is returned empty, so nothing is run
+
+        if (editor.length + 2 > *size) {
+            *size = editor.length + 2;
+            *line = realloc(*line, *size);
+        }
+
+        memcpy(*line, editor.buffer, editor.length);
+        (*line)[editor.length] = '\n';
+        (*line)[editor.length + 1] = '\0';
+        length = editor.length + 1;
+    }
+
+    free(editor.buffer);
+    free(editor.shown);
+    free(editor.out);
+    free(editor.saved);
+    free(editor.query);
+    free(editor.promptText);
+
+    return length;
+}
@@ -1,29 +1,35 @@
 // Here we include methods relating to setting and getting parameters relating to the environment
 // This includes details such as PATH and HOME
 
+char *currentDirectory = NULL; // Cached working directory, only the shell can change it, see changeDirectory()
+
 /**
 * Sets the environmental variable PATH to newPath
 * @param newPath: String for the new directory to be added to path
+* @return 0 on success, 1 on error
 */
-void setPath(char *newPath) {
+int setPath(char *newPath) {
     // Path must be specified
     if (newPath == NULL) {
         red("[Error] ");
         printf("You must specify a directory!\n");
-        return;
+        return 1;
     }
 
     // Check if path exists on system, can we read from it?
     if(access(newPath, R_OK) != 0) {
         red("[Error] ");
         printf("Directory \"%s\" doesn't exist, or you do not have read access.\n", newPath);
-        return;
+        return 1;
     }
 
-    // Set new path
+    // Set new path, previously hashed commands may now resolve elsewhere
     setenv("PATH", newPath, 1);
+    hashReset();
+    completionPathChanged();
     blue("[Info] ");
     printf("PATH has been updated to: %s\n", getPath());
+    return 0;
 }
 
 
@@ -31,13 +37,14 @@ void setPath(char *newPath) {
   * Appends a directory to the system PATH
   * Checks that the directory does not already exist in path, if it does then the directory is not added
   * @param *newPath: String for the new directory to be added to the path
+  * @return 0 on success, 1 on error
   */
-void addPath(char *newPath){
+int addPath(char *newPath){
     // Path must be specified
     if (newPath == NULL) {
         red("[Error] ");
         printf("You must specify a path\n");
-        return;
+        return 1;
     }
 
     printf("Adding: %s to path\n", newPath);
@@ -75,7 +82,7 @@ void addPath(char *newPath){
     if(strstr(pathCompare, newPathCompare) != NULL) {
         yellow("[Warning] ");
         printf("%s already exists in PATH\n", newPath);
-        return;
+        return 0;
     }
 
     /* Append newPath to the current PATH, the result should be "PATH:newPath"
@@ -90,11 +97,15 @@ void addPath(char *newPath){
     strcat(buffer, newPath);
 
     // Set the new PATH Variable
+    // The command hash table does not need to be cleared, the new directory comes last in PATH so any command that
+    // has already been hashed will still be found in the same place
     setenv("PATH", buffer, 1);
+    completionPathChanged();
 
     // Display the new PATH
     blue("[Info] ");
     printf("Path has been updated to: %s\n",  getPath());
+    return 0;
 }
 
 
@@ -104,26 +115,28 @@ char *getPath() {
 }
 
 
-/* Set home directory */
-void setHome(char *dir) {
+/* Set home directory, returns 0 on success */
+int setHome(char *dir) {
     // Path must be specified
     if (dir == NULL) {
         red("[Error] ");
         printf("You must specify a directory!\n");
-        return;
+        return 1;
     }
 
     // Check if path exists on system, can we read from it?
     if(access(dir, R_OK) != 0) {
         red("[Error] ");
         printf("Directory \"%s\" doesn't exist, or you do not have read access.\n", dir);
-        return;
+        return 1;
     }
 
-    // Set path
+    // Set path, the prompt shows ~/ in the home directory
     setenv("HOME", dir, 1);
+    promptChanged();
     blue("[Info] ");
     printf("Home directory has been updated to: %s\n", getHome());
+    return 0;
 }
 
 
@@ -133,8 +146,25 @@ char *getHome() {
 }
 
 
-/* Return the current working directory */
-char *printCwd() {
-    char cwd[MAX_PATH];
-    return getcwd(cwd, MAX_PATH);
+/* Return the current working directory, which is only looked up again after changing directory */
+char *getCwd() {
+    if (currentDirectory == NULL) {
+        currentDirectory = getcwd(NULL, 0);
+        if (currentDirectory == NULL) { currentDirectory = strdup("."); } // e.g. it has been deleted
+    }
+
+    return currentDirectory;
+}
+
+
+/* Change the working directory, returns 0 on success */
+int changeDirectory(char *dir) {
+    if (chdir(dir) != 0) { return 1; }
+
+    // Look the directory up again next time, and rebuild the prompt to show it
+    free(currentDirectory);
+    currentDirectory = NULL;
+    promptChanged();
+
+    return 0;
 }
\ No newline at end of file
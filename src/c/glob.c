@@ -0,0 +1,714 @@
+// Here we expand globs, e.g. "ls *.c", into the paths they match, sorted by name
+//      *       Any run of characters, including none
+//      ?       Any one character
+//      [...]   Any one of the characters inside, which may include ranges such as [a-z] and named classes such as
+//              [:digit:]. [!...] or [^...] matches any character that isn't inside
+//      **      As a whole part of a path, any number of directories, e.g. src/**/*.c finds .c files at any depth
+// Only unquoted * ? and [ are special. The lexer leaves them as GLOB_STAR, GLOB_ONE and GLOB_CLASS, so "*.c" and \*.c
+// stay as they are. A name beginning with . is only matched by a pattern beginning with ., and ** doesn't look inside
+// hidden directories or follow links to directories. A glob that matches nothing is left as it was typed.
+//
+// Directories are read with getdents64 in large blocks, and each listing is sorted once and then cached, keyed by the
+// directory's device and inode. A listing is reused until the directory's modification time changes, which happens
+// whenever an entry is added, removed or renamed, so globbing the same directory again costs a single stat(). As
+// listings are sorted, the names beginning with the literal start of a pattern, e.g. "log-" in log-*.txt, are found
+// with a binary search, and the paths matched in one directory are already in order. Names are compared byte by byte.
+
+DirListing **globCache = NULL; // Open addressing table of directory listings, keyed by device and inode
+int globCacheSize = 0; // Number of slots in globCache, always a power of 2
+int globCacheCount = 0; // Number of slots in use
+size_t globCacheBytes = 0; // Memory used by the listings in globCache
+char *CLASS_NAMES[] = { "alnum", "alpha", "blank", "cntrl", "digit", "graph", "lower", "print", "punct", "space", "upper", "xdigit" }; // Named classes that can be used inside [...], e.g. [[:digit:]]
+int (*CLASS_TESTS[])(int) = { isalnum, isalpha, isblank, iscntrl, isdigit, isgraph, islower, isprint, ispunct, isspace, isupper, isxdigit }; // Test for each of CLASS_NAMES
+
+
+/* The character that a glob mark was in place of */
+char unmarked(char c) {
+    return (c == GLOB_STAR) ? '*' : (c == GLOB_ONE) ? '?' : (c == GLOB_CLASS) ? '[' : c;
+}
+
+
+/* Put back each glob mark in a token, for a glob that matched nothing or can't be expanded */
+void unmarkToken(char *token) {
+    for (char *c = token; *c; ++c) { *c = unmarked(*c); }
+}
+
+
+/* Return if there are any glob marks between start and end */
+int hasMarks(char *start, char *end) {
+    for (char *c = start; c < end; ++c) {
+        if (*c == GLOB_STAR || *c == GLOB_ONE || *c == GLOB_CLASS) { return 1; }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Find the end of a named class inside a class, e.g. [:digit:] in [[:digit:]_]
+ * @param text Where the named class may begin, at a [ or a GLOB_CLASS mark
+ * @return The : before its closing ], or NULL if there isn't a named class at text
+ */
+const char *namedClassEnd(const char *text) {
+    if ((*text != '[' && *text != GLOB_CLASS) || text[1] != ':') { return NULL; }
+
+    const char *name = text + 2;
+    while (islower((unsigned char) *name)) { name++; }
+
+    return (name > text + 2 && name[0] == ':' && name[1] == ']') ? name : NULL;
+}
+
+
+/**
+ * Match one character against a named class
+ * @param name The name, e.g. digit
+ * @param length Length of the name
+ * @param c The character to match
+ * @return 1 if the character is in the class, 0 if not or if there is no class of that name
+ */
+int namedClassMatch(const char *name, size_t length, unsigned char c) {
+    for (size_t i = 0; i < sizeof(CLASS_NAMES) / sizeof(CLASS_NAMES[0]); ++i) {
+        if (strncmp(CLASS_NAMES[i], name, length) == 0 && CLASS_NAMES[i][length] == 0) { return CLASS_TESTS[i](c) != 0; }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Find the ] that closes a class. A ] straight after the [, or after [! or [^, is part of the class, and so is the ]
+ * of a named class such as [:alpha:]
+ * @param class Just after the GLOB_CLASS beginning the class
+ * @return The closing ], or NULL if the class isn't closed within the same part of the path
+ */
+char *classEnd(char *class) {
+    if (*class == '!' || *class == '^') { class++; }
+    if (*class == ']') { class++; }
+
+    for (; *class != 0 && *class != '/'; ++class) {
+        const char *named = namedClassEnd(class);
+
+        if (named != NULL) { class += named + 1 - class; } // Its ], the loop then moves past it
+        else if (*class == ']') { return class; }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Check the classes in a token, so that matching can rely on them. A [ without a closing ], e.g. in "[ -f x ]", is put
+ * back as a plain [, and so is any * or ? inside a class, e.g. [*?]
+ *
+ * @param token The token, as left by the lexer
+ * @return 1 if the token still holds a glob, 0 if it is plain text
+ */
+int checkClasses(char *token) {
+    int glob = 0;
+
+    for (char *c = token; *c; ++c) {
+        if (*c == GLOB_STAR || *c == GLOB_ONE) {
+            glob = 1;
+        } else if (*c == GLOB_CLASS) {
+            char *end = classEnd(c + 1);
+
+            if (end == NULL) {
+                *c = '[';
+                continue;
+            }
+
+            for (char *inside = c + 1; inside < end; ++inside) { *inside = unmarked(*inside); }
+            c = end;
+            glob = 1;
+        }
+    }
+
+    return glob;
+}
+
+
+/**
+ * Match one character against a class, e.g. [a-z] or [[:alpha:]_]
+ * @param class Just after the GLOB_CLASS beginning the class, which checkClasses() has found the end of
+ * @param c The character to match
+ * @param end Set to just after the closing ]
+ * @return 1 if the character is matched by the class
+ */
+int classMatch(const char *class, unsigned char c, const char **end) {
+    int invert = (*class == '!' || *class == '^');
+    int found = 0;
+
+    if (invert) { class++; }
+
+    do { // The first character is never the closing ], see classEnd()
+        const char *named = namedClassEnd(class);
+
+        if (named != NULL) {
+            if (namedClassMatch(class + 2, named - class - 2, c)) { found = 1; }
+            class = named + 2;
+            continue;
+        }
+
+        unsigned char low = class[0];
+        unsigned char high = low;
+
+        if (class[1] == '-' && class[2] != ']') {
+            high = class[2];
+            class += 3;
+        } else {
+            class++;
+        }
+
+        if (c >= low && c <= high) { found = 1; }
+    } while (*class != ']');
+
+    *end = class + 1;
+    return found != invert;
+}
+
+
+/**
+ * Match a name against one part of a pattern. Each * remembers where it started, and on a mismatch the most recent *
+ * takes one more character, which is enough to match any pattern without going back further
+ *
+ * @param pattern The part of the pattern, NUL terminated, with * ? and [ marked by the lexer
+ * @param name The name to match
+ * @return 1 if the pattern matches the whole name
+ */
+int globMatch(const char *pattern, const char *name) {
+    const char *starPattern = NULL; // Just after the most recent *
+    const char *starName = NULL; // Where the most recent * started matching
+
+    while (*name) {
+        const char *next;
+
+        if (*pattern == GLOB_STAR) {
+            while (*pattern == GLOB_STAR) { pattern++; }
+            if (*pattern == 0) { return 1; }
+
+            starPattern = pattern;
+            starName = name;
+        } else if (*pattern == GLOB_ONE) {
+            pattern++;
+            name++;
+        } else if (*pattern == GLOB_CLASS && classMatch(pattern + 1, *name, &next)) {
+            pattern = next;
+            name++;
+        } else if (*pattern != GLOB_CLASS && *pattern != 0 && *pattern == *name) {
+            pattern++;
+            name++;
+        } else if (starPattern != NULL) {
+            pattern = starPattern;
+            name = ++starName;
+        } else {
+            return 0;
+        }
+    }
+
+    while (*pattern == GLOB_STAR) { pattern++; }
+    return *pattern == 0;
+}
+
+
+/* The first 8 bytes of a name as a big endian number, padded with 0s, see GlobEntry */
+uint64_t nameKey(const char *name) {
+    uint64_t key = 0;
+
+    for (int i = 0; i < 8 && name[i]; ++i) { key |= (uint64_t) (unsigned char) name[i] << (56 - 8 * i); }
+
+    return key;
+}
+
+
+/* Order directory entries by name, byte by byte. Names only need comparing in full when their first 8 bytes match */
+int compareEntries(const void *a, const void *b) {
+    const GlobEntry *x = a;
+    const GlobEntry *y = b;
+
+    if (x->key != y->key) { return (x->key < y->key) ? -1 : 1; }
+    return strcmp(x->name, y->name);
+}
+
+
+/**
+ * Read every entry of a directory with getdents64, then sort them
+ * @param fd The directory
+ * @param listing Filled in with the entries
+ * @return 0 on success, -1 if the directory couldn't be read, in which case nothing is allocated
+ */
+int readListing(int fd, DirListing *listing) {
+    char *buffer = malloc(GLOB_BUFFER);
+    size_t size = GLOB_BUFFER;
+    size_t length = 0;
+    int capacity = 64;
+    ssize_t got;
+
+    listing->names = malloc(size);
+    listing->entries = malloc(capacity * sizeof(GlobEntry));
+    listing->count = 0;
+
+    while ((got = getdents64(fd, buffer, GLOB_BUFFER)) > 0) {
+        for (ssize_t at = 0; at < got;) {
+            struct dirent64 *entry = (struct dirent64 *) (buffer + at);
+            char *name = entry->d_name;
+            at += entry->d_reclen;
+
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) { continue; }
+
+            size_t nameLength = strlen(name) + 1;
+
+            while (length + nameLength > size) {
+                size *= 2;
+                listing->names = realloc(listing->names, size);
+            }
+
+            if (listing->count == capacity) {
+                capacity *= 2;
+                listing->entries = realloc(listing->entries, capacity * sizeof(GlobEntry));
+            }
+
+            // Names may still move as the block grows, so keep where each begins until they are all read
+            memcpy(listing->names + length, name, nameLength);
+            listing->entries[listing->count].name = (char *) (uintptr_t) length;
+            listing->entries[listing->count++].type = entry->d_type;
+            length += nameLength;
+        }
+    }
+
+    free(buffer);
+
+    if (got < 0) {
+        free(listing->names);
+        free(listing->entries);
+        listing->names = NULL;
+        listing->entries = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < listing->count; ++i) {
+        listing->entries[i].name = listing->names + (uintptr_t) listing->entries[i].name;
+        listing->entries[i].key = nameKey(listing->entries[i].name);
+    }
+
+    qsort(listing->entries, listing->count, sizeof(GlobEntry), compareEntries);
+    listing->bytes = size + capacity * sizeof(GlobEntry);
+    return 0;
+}
+
+
+/**
+ * Find the slot for a directory in the listing cache
+ * Linear probing is used, so we stop at either the directory's listing or the first empty slot
+ *
+ * @param device Device holding the directory
+ * @param inode Inode of the directory
+ * @return Index of the slot holding the listing, or the empty slot where it should be inserted
+ */
+int listingSlot(dev_t device, ino_t inode) {
+    int i = (int) ((inode * 2654435761u) ^ device) & (globCacheSize - 1);
+
+    while (globCache[i] != NULL && (globCache[i]->inode != inode || globCache[i]->device != device)) {
+        i = (i + 1) & (globCacheSize - 1);
+    }
+
+    return i;
+}
+
+
+/* Free a listing and the entries it holds */
+void freeListing(DirListing *listing) {
+    free(listing->names);
+    free(listing->entries);
+    free(listing);
+}
+
+
+/**
+ * Move every listing into a new table of the given size. This grows the table once it is half full, or with keepAll 0
+ * empties it once the listings use more than GLOB_CACHE_BYTES, keeping only those being walked by the current glob
+ *
+ * @param size Number of slots in the new table, a power of 2
+ * @param keepAll 1 to keep every listing, 0 to free those that aren't being walked
+ */
+void rebuildCache(int size, int keepAll) {
+    DirListing **old = globCache;
+    int oldSize = globCacheSize;
+
+    globCache = calloc(size, sizeof(DirListing *));
+    globCacheSize = size;
+    globCacheCount = 0;
+    globCacheBytes = 0;
+
+    for (int i = 0; i < oldSize; ++i) {
+        if (old[i] == NULL) { continue; }
+
+        if (!keepAll && old[i]->pinned == 0) {
+            freeListing(old[i]);
+            continue;
+        }
+
+        globCache[listingSlot(old[i]->device, old[i]->inode)] = old[i];
+        globCacheCount++;
+        globCacheBytes += old[i]->bytes;
+    }
+
+    free(old);
+}
+
+
+/**
+ * Find the sorted listing of a directory, reading it if it isn't cached or has changed since it was read
+ * A directory modified in the same second it was read may have changed again since without its modification time
+ * moving on, so that listing is read again next time rather than trusted
+ *
+ * @param path The directory, "" for the working directory
+ * @return The listing, or NULL if it isn't a directory or couldn't be read. Give it back with releaseListing()
+ */
+DirListing *listDirectory(char *path) {
+    char *name = (*path == 0) ? "." : path;
+    struct stat info;
+
+    if (stat(name, &info) != 0 || !S_ISDIR(info.st_mode)) { return NULL; }
+    if (globCache == NULL) { rebuildCache(GLOB_CACHE_SIZE, 1); }
+
+    DirListing *listing = globCache[listingSlot(info.st_dev, info.st_ino)];
+
+    if (listing != NULL && listing->entries != NULL && listing->modified.tv_sec == info.st_mtim.tv_sec
+        && listing->modified.tv_nsec == info.st_mtim.tv_nsec && listing->modified.tv_sec < listing->read) {
+        listing->pinned++;
+        return listing;
+    }
+
+    int fd = open(name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) { return NULL; }
+
+    if (listing != NULL && listing->pinned > 0) {
+        // Being walked by a glob further up, e.g. a link back to a parent directory, so it can't be replaced
+        listing = calloc(1, sizeof(DirListing));
+        listing->temporary = 1;
+    } else if (listing != NULL) {
+        globCacheBytes -= listing->bytes;
+        free(listing->names);
+        free(listing->entries);
+        listing->entries = NULL;
+    } else {
+        if (globCacheBytes > GLOB_CACHE_BYTES) { rebuildCache(globCacheSize, 0); }
+        if ((globCacheCount + 1) * 2 > globCacheSize) { rebuildCache(globCacheSize * 2, 1); }
+
+        listing = calloc(1, sizeof(DirListing));
+        listing->device = info.st_dev;
+        listing->inode = info.st_ino;
+        globCache[listingSlot(info.st_dev, info.st_ino)] = listing;
+        globCacheCount++;
+    }
+
+    listing->modified = info.st_mtim; // From before reading, so a change made while reading is noticed next time
+    listing->read = time(NULL);
+
+    int failed = readListing(fd, listing);
+    close(fd);
+
+    if (failed) { // A listing left in the cache without entries is read again next time
+        if (listing->temporary) { free(listing); }
+        return NULL;
+    }
+
+    if (!listing->temporary) { globCacheBytes += listing->bytes; }
+    listing->pinned++;
+    return listing;
+}
+
+
+/* Finish with a listing from listDirectory() */
+void releaseListing(DirListing *listing) {
+    if (listing->temporary) { freeListing(listing); }
+    else { listing->pinned--; }
+}
+
+
+/* Index of the first entry in a listing that doesn't sort before prefix */
+int firstWithPrefix(DirListing *listing, const char *prefix, size_t length) {
+    int low = 0;
+    int high = listing->count;
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+
+        if (strncmp(listing->entries[middle].name, prefix, length) < 0) { low = middle + 1; }
+        else { high = middle; }
+    }
+
+    return low;
+}
+
+
+/**
+ * Add a path matched by a glob, unless that would make the command too long to run
+ * @param walk The walk, whose path is added
+ * @param length Length of the path
+ */
+void addMatch(GlobWalk *walk, size_t length) {
+    walk->space -= length + 1 + sizeof(char *);
+    if (walk->space < 0) {
+        walk->overflow = 1;
+        return;
+    }
+
+    while (walk->length + length + 1 > walk->size) {
+        walk->size = (walk->size == 0) ? 4096 : walk->size * 2;
+        walk->paths = realloc(walk->paths, walk->size);
+    }
+
+    if (walk->count == walk->capacity) {
+        walk->capacity = (walk->capacity == 0) ? 64 : walk->capacity * 2;
+        walk->starts = realloc(walk->starts, walk->capacity * sizeof(size_t));
+    }
+
+    memcpy(walk->paths + walk->length, walk->path, length + 1);
+    walk->starts[walk->count++] = walk->length;
+    walk->length += length + 1;
+}
+
+
+/* Return if a directory entry is a directory, without following links */
+int isDirectoryEntry(GlobWalk *walk, GlobEntry *entry) {
+    if (entry->type != DT_UNKNOWN) { return entry->type == DT_DIR; }
+
+    struct stat info;
+    return lstat(walk->path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+
+/**
+ * Match the rest of a pattern that follows **, in a directory and in every directory below it that isn't hidden
+ *
+ * @param walk The walk, whose path holds the directory to look in
+ * @param length Length of that path
+ * @param rest The pattern after the ** and its /, or NULL if ** ended the pattern, which matches every path below
+ * @param self 1 to match the directory itself too, for a pattern ending in ** after a directory. It is matched without
+ *             the / after it, e.g. a/b rather than a/b/
+ */
+void globAnyDepth(GlobWalk *walk, size_t length, char *rest, int self) {
+    DirListing *listing = listDirectory(walk->path);
+    if (listing == NULL) { return; }
+
+    if (self && length > 1) {
+        walk->path[length - 1] = 0;
+        addMatch(walk, length - 1);
+        walk->path[length - 1] = '/';
+    } else if (self) {
+        addMatch(walk, length); // The root directory, /
+    }
+    if (rest != NULL) { globWalk(walk, length, rest); }
+
+    for (int i = 0; i < listing->count && !walk->overflow; ++i) {
+        GlobEntry *entry = &listing->entries[i];
+        size_t nameLength = strlen(entry->name);
+
+        if (entry->name[0] == '.' || length + nameLength + 2 > MAX_PATH) { continue; }
+
+        memcpy(walk->path + length, entry->name, nameLength + 1);
+        if (rest == NULL) { addMatch(walk, length + nameLength); }
+
+        if (isDirectoryEntry(walk, entry)) {
+            walk->path[length + nameLength] = '/';
+            walk->path[length + nameLength + 1] = 0;
+            globAnyDepth(walk, length + nameLength + 1, rest, 0);
+        }
+    }
+
+    walk->path[length] = 0;
+    releaseListing(listing);
+}
+
+
+/**
+ * Match a pattern against the file system, one part of the path at a time, adding each path that it matches
+ *
+ * @param walk The walk, whose path holds the directory to look in
+ * @param length Length of that path
+ * @param pattern The rest of the pattern, beginning with the part to match in that directory
+ */
+void globWalk(GlobWalk *walk, size_t length, char *pattern) {
+    char *slash = strchr(pattern, '/');
+    char *end = (slash != NULL) ? slash : pattern + strlen(pattern);
+    size_t partLength = end - pattern;
+
+    if (walk->overflow || length + partLength + 2 > MAX_PATH) { return; }
+
+    // A part without any globs is taken as it is, e.g. src in src/*.c. The path only has to exist once it is complete,
+    // and a path ending in / only exists if it is a directory
+    if (!hasMarks(pattern, end)) {
+        memcpy(walk->path + length, pattern, partLength);
+        length += partLength;
+
+        if (slash != NULL) {
+            walk->path[length++] = '/';
+            walk->path[length] = 0;
+            globWalk(walk, length, slash + 1);
+            return;
+        }
+
+        struct stat info;
+        walk->path[length] = 0;
+        if (lstat(walk->path, &info) == 0) { addMatch(walk, length); }
+        return;
+    }
+
+    // **, any number of directories
+    if (partLength == 2 && pattern[0] == GLOB_STAR && pattern[1] == GLOB_STAR) {
+        globAnyDepth(walk, length, (slash != NULL) ? slash + 1 : NULL, slash == NULL && length > 0);
+        return;
+    }
+
+    DirListing *listing = listDirectory(walk->path);
+    if (listing == NULL) { return; }
+
+    // Any other part is matched against the names in the directory that begin with its literal start
+    char saved = *end;
+    *end = 0;
+
+    size_t prefixLength = strcspn(pattern, GLOB_MARKS);
+    int hidden = (pattern[0] == '.'); // Names beginning with . are only matched by a pattern beginning with .
+
+    for (int i = firstWithPrefix(listing, pattern, prefixLength); i < listing->count && !walk->overflow; ++i) {
+        GlobEntry *entry = &listing->entries[i];
+
+        if (strncmp(entry->name, pattern, prefixLength) != 0) { break; }
+        if (entry->name[0] == '.' && !hidden) { continue; }
+        if (!globMatch(pattern + prefixLength, entry->name + prefixLength)) { continue; }
+
+        size_t nameLength = strlen(entry->name);
+        if (length + nameLength + 2 > MAX_PATH) { continue; }
+
+        memcpy(walk->path + length, entry->name, nameLength + 1);
+
+        if (slash == NULL) {
+            addMatch(walk, length + nameLength);
+        } else if (entry->type == DT_DIR || entry->type == DT_LNK || entry->type == DT_UNKNOWN) {
+            walk->path[length + nameLength] = '/';
+            walk->path[length + nameLength + 1] = 0;
+            globWalk(walk, length + nameLength + 1, slash + 1);
+        }
+    }
+
+    *end = saved;
+    walk->path[length] = 0;
+    releaseListing(listing);
+}
+
+
+/* Order paths matched by a glob, given where each begins in the block of paths */
+int comparePaths(const void *a, const void *b, void *paths) {
+    return strcmp((char *) paths + *(const size_t *) a, (char *) paths + *(const size_t *) b);
+}
+
+
+/**
+ * Sort the paths matched by one glob. Paths from a single directory come out of its sorted listing in order already,
+ * so they are only sorted if they came from several directories, e.g. for a glob in the middle of the path
+ *
+ * @param walk The walk
+ * @param first Index of the first path matched by the glob
+ */
+void sortMatches(GlobWalk *walk, int first) {
+    for (int i = first + 1; i < walk->count; ++i) {
+        if (strcmp(walk->paths + walk->starts[i - 1], walk->paths + walk->starts[i]) > 0) {
+            qsort_r(&walk->starts[first], walk->count - first, sizeof(size_t), comparePaths, walk->paths);
+            return;
+        }
+    }
+}
+
+
+/**
+ * Expand the globs in the tokens of a command into the paths they match, each glob being replaced by its paths in
+ * sorted order. A glob that matches nothing is left as it was typed. The target of a redirection, e.g. "> *.txt", must
+ * match no more than one path. Altogether the tokens must fit in ARG_MAX, so the command can still be run
+ *
+ * @param tokens The tokens of the command, as left by the lexer. Globs that aren't expanded are unmarked in place
+ * @param n Number of tokens
+ * @param glob Filled in with the tokens after expansion
+ * @return The number of tokens after expansion, or -1 if they can't be expanded. An error will have been displayed
+ */
+int expandGlobs(char *tokens[], int n, Glob *glob) {
+    long long started = nanoseconds();
+    int globs = 0;
+
+    glob->tokens = tokens;
+    glob->paths = NULL;
+
+    for (int i = 0; i < n; ++i) {
+        if (strpbrk(tokens[i], GLOB_MARKS) != NULL) { globs++; }
+    }
+
+    if (globs == 0) {
+        stopTimer(TIMER_GLOB, started);
+        return n;
+    }
+
+    GlobWalk *walk = calloc(1, sizeof(GlobWalk)); // Holds a whole path, too much for the stack of a deep **
+    int *first = malloc(n * sizeof(int)); // Index of the first path matched by each token, if it was expanded
+    int *matched = calloc(n, sizeof(int)); // Number of paths matched by each token, 0 if it is left as it is
+    int count = 0;
+
+    walk->space = argumentSpace();
+
+    for (int i = 0; i < n && count >= 0; ++i) {
+        walk->space -= strlen(tokens[i]) + 1 + sizeof(char *);
+        if (strpbrk(tokens[i], GLOB_MARKS) == NULL || !checkClasses(tokens[i])) {
+            count++;
+            continue;
+        }
+
+        first[i] = walk->count;
+        walk->path[0] = 0;
+        globWalk(walk, 0, tokens[i]);
+        matched[i] = walk->count - first[i];
+        unmarkToken(tokens[i]);
+
+        if (walk->overflow) {
+            red("[Error] ");
+            printf("%s matches too many paths to run a command with. Please try a narrower pattern\n", tokens[i]);
+            count = -1;
+        } else if (matched[i] > 1 && i > 0 && isRedirect(operatorType(tokens[i - 1]))) {
+            red("[Error] ");
+            printf("%s matches %i paths, so it can't be redirected to or from\n", tokens[i], matched[i]);
+            count = -1;
+        } else {
+            sortMatches(walk, first[i]);
+            count += (matched[i] > 0) ? matched[i] : 1;
+        }
+    }
+
+    if (count > 0 && walk->count > 0) {
+        glob->tokens = malloc((count + 1) * sizeof(char *));
+        glob->paths = walk->paths;
+        walk->paths = NULL;
+
+        for (int i = 0, t = 0; i < n; ++i) {
+            if (matched[i] == 0) { glob->tokens[t++] = tokens[i]; }
+            for (int m = 0; m < matched[i]; ++m) { glob->tokens[t++] = glob->paths + walk->starts[first[i] + m]; }
+        }
+
+        glob->tokens[count] = NULL;
+    }
+
+    free(walk->paths);
+    free(walk->starts);
+    free(walk);
+    free(first);
+    free(matched);
+
+    stopTimer(TIMER_GLOB, started);
+    return count;
+}
+
+
+/* Free the memory used by the tokens from expandGlobs() */
+void freeGlob(Glob *glob) {
+    if (glob->paths == NULL) { return; }
+
+    free(glob->tokens);
+    free(glob->paths);
+}
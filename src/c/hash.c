@@ -0,0 +1,231 @@
+// Here we keep a table of commands that have already been found on the PATH, mapping each command name to the
+// absolute path of its executable. This saves walking every directory in PATH each time a command is run, and lets us
+// report unknown commands without having to fork first.
+
+typedef struct {
+    char *name; // Command name as typed by the user, e.g. ls
+    char *path; // Absolute path of the executable, e.g. /bin/ls
+    int hits; // Number of times this entry has been used
+} HashEntry;
+
+HashEntry *hashTable = NULL; // Open addressing table of hashed commands, NULL until the first lookup
+int hashSize = 0; // Number of slots in hashTable, always a power of 2
+int hashCount = 0; // Number of slots in use
+int hashHits = 0; // Lookups answered from the table
+int hashMisses = 0; // Lookups which had to search PATH
+
+
+/* FNV-1a hash of a command name */
+unsigned int hashString(char *s) {
+    unsigned int h = 2166136261u;
+
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+
+/**
+ * Find the slot for a command in the hash table
+ * Linear probing is used, so we stop at either the matching entry or the first empty slot
+ *
+ * @param command The command name to find
+ * @return Index of the slot holding the command, or the empty slot where it should be inserted
+ */
+int hashSlot(char *command) {
+    int i = hashString(command) & (hashSize - 1);
+
+    while (hashTable[i].name != NULL && strcmp(hashTable[i].name, command) != 0) {
+        i = (i + 1) & (hashSize - 1);
+    }
+
+    return i;
+}
+
+
+/**
+ * Double the size of the hash table (or create it) and re-insert all existing entries
+ * The table is kept at most half full so that probe sequences stay short
+ */
+void hashGrow() {
+    HashEntry *old = hashTable;
+    int oldSize = hashSize;
+
+    hashSize = (oldSize == 0) ? HASH_SIZE : oldSize * 2;
+    hashTable = calloc(hashSize, sizeof(HashEntry));
+
+    for (int i = 0; i < oldSize; ++i) {
+        if (old[i].name != NULL) {
+            hashTable[hashSlot(old[i].name)] = old[i];
+        }
+    }
+
+    free(old);
+}
+
+
+/**
+ * Walk each directory in PATH looking for an executable called command
+ * An empty PATH entry refers to the current directory, as in a regular shell
+ *
+ * @param command The command to search for
+ * @param relative Set to 1 if the command was found through a relative PATH entry, so it should not be cached
+ * @return A newly allocated path to the executable, or NULL if not found
+ */
+char *searchPath(char *command, int *relative) {
+    char *path = getPath();
+    struct stat st;
+
+    if (path == NULL) { return NULL; }
+
+    while (*path) {
+        char *end = strchr(path, ':');
+        int dirLength = (end == NULL) ? (int) strlen(path) : (int) (end - path);
+
+        // Build up <dir>/<command>, using "." for an empty entry
+        char *candidate = malloc(dirLength + strlen(command) + 3);
+        if (dirLength == 0) {
+            strcpy(candidate, ".");
+        } else {
+            memcpy(candidate, path, dirLength);
+            candidate[dirLength] = 0;
+        }
+        strcat(candidate, "/");
+        strcat(candidate, command);
+
+        // Must be a regular file that we can execute
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            *relative = (candidate[0] != '/');
+            return candidate;
+        }
+
+        free(candidate);
+
+        if (end == NULL) { break; }
+        path = end + 1;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Find the executable for a command, consulting the hash table first and only searching PATH on a miss.
+ * Commands containing a "/" are paths already, so these are returned as long as they can be executed.
+ *
+ * A hashed executable is checked to be present before it is returned, if it has been removed since it was hashed
+ * then the entry is forgotten and PATH is searched again.
+ *
+ * @param command The command entered by the user, i.e. tokens[0]
+ * @return The path to execute, or NULL if the command was not found
+ */
+char *hashLookup(char *command) {
+    // An explicit path, such as ./a.out or /bin/ls, no need to search
+    if (strchr(command, '/') != NULL) {
+        return (access(command, X_OK) == 0) ? command : NULL;
+    }
+
+    if (hashTable == NULL) { hashGrow(); }
+
+    int slot = hashSlot(command);
+
+    if (hashTable[slot].name != NULL) {
+        // Hashed executable still exists, use it
+        if (access(hashTable[slot].path, X_OK) == 0) {
+            hashTable[slot].hits++;
+            hashHits++;
+            return hashTable[slot].path;
+        }
+
+        // Executable has been removed or moved since we hashed it, look for it again
+        hashForget(command);
+    }
+
+    hashMisses++;
+
+    int relative = 0;
+    char *found = searchPath(command, &relative);
+
+    // Only cache absolute paths, relative ones depend on the current working directory
+    if (found == NULL || relative) {
+        return found;
+    }
+
+    if ((hashCount + 1) * 2 > hashSize) { hashGrow(); }
+
+    slot = hashSlot(command);
+    hashTable[slot].name = strdup(command);
+    hashTable[slot].path = found;
+    hashTable[slot].hits = 1;
+    hashCount++;
+
+    return found;
+}
+
+
+/**
+ * Remove a command from the hash table
+ * Entries after it in the same probe sequence are re-inserted so that they can still be found
+ *
+ * @param command The command to forget
+ */
+void hashForget(char *command) {
+    if (hashTable == NULL) { return; }
+
+    int slot = hashSlot(command);
+    if (hashTable[slot].name == NULL) { return; }
+
+    free(hashTable[slot].name);
+    free(hashTable[slot].path);
+    hashTable[slot].name = NULL;
+    hashCount--;
+
+    // Re-insert the rest of the cluster
+    int i = (slot + 1) & (hashSize - 1);
+    while (hashTable[i].name != NULL) {
+        HashEntry entry = hashTable[i];
+        hashTable[i].name = NULL;
+        hashTable[hashSlot(entry.name)] = entry;
+        i = (i + 1) & (hashSize - 1);
+    }
+}
+
+
+/* Forget every hashed command. Hit and miss counts are kept */
+void hashReset() {
+    for (int i = 0; i < hashSize; ++i) {
+        if (hashTable[i].name != NULL) {
+            free(hashTable[i].name);
+            free(hashTable[i].path);
+            hashTable[i].name = NULL;
+        }
+    }
+
+    hashCount = 0;
+}
+
+
+/* Display the contents of the command hash table, along with the total number of hits and misses */
+void dispHash() {
+    if (hashCount == 0) {
+        blue("[Info] ");
+        printf("The command hash table is empty\n");
+    } else {
+        blue(" = Command Hash Begin =\n");
+        printf(" Hits\tCommand\n");
+
+        for (int i = 0; i < hashSize; ++i) {
+            if (hashTable[i].name != NULL) {
+                printf(" %i\t%s\n", hashTable[i].hits, hashTable[i].path);
+            }
+        }
+
+        blue(" = Command Hash End =\n");
+    }
+
+    blue("[Info] ");
+    printf("%i hits, %i misses\n", hashHits, hashMisses);
+}
\ No newline at end of file
@@ -0,0 +1,541 @@
+// Here we keep the history file, .hist_list in the users' home directory, which holds one command per line
+// Each command is appended to the file as soon as it is entered, so nothing is lost if the shell is killed or the
+// terminal is closed. Appends use O_APPEND, so several shells can share the one file without overwriting each other.
+// Commands are synced to disk every HISTSYNC commands (Default HISTORY_SYNC), HISTSYNC=1 syncs every command and
+// HISTSYNC=0 leaves it to the system.
+// Every command in the file is kept in memory, numbered from 1 (oldest) in the order it was entered. Nothing is read
+// until history is first used, so it costs nothing before the first prompt. The file is then read by a thread in the
+// background, which copies it into one block of memory and indexes every trigram (three
+// characters in a row) of every command, so that searches only look at commands which could match. Anything that
+// needs history waits for that thread first, see waitHistory(). History is never trimmed unless HISTKEEP is set, in
+// which case once the file grows past HISTORY_COMPACT_BYTES, a child process rewrites it in the background to hold only
+// the last HISTKEEP commands. Commands then take new numbers, as the older ones are gone
+
+char *historyPath = NULL; // Absolute path of the history file, NULL if there is no history file (e.g. scripts)
+int historyOpened = 0; // 1 once loadHistory() has been called, see useHistory()
+int historyFd = -1; // History file, opened for appending
+int historySync = HISTORY_SYNC; // Sync to disk after this many commands, 0 to never sync
+int historyKeep = 0; // Number of commands kept when the history file is compacted, 0 to keep every command
+int historyUnsynced = 0; // Commands appended since the last sync
+off_t historyBytes = 0; // Approximate size of the history file, used to decide when to compact it
+int historyCompacting = 0; // 1 once compaction has been started this session, so that it is only started once
+
+char **historyEntries = NULL; // Every command in history, command number n is historyEntries[n - 1]
+int historyCount = 0; // Number of commands in history
+int historyCapacity = 0; // Space in historyEntries before it has to grow
+char *historyBlock = NULL; // Copy of the history file the loaded commands point into, NULL if none was loaded
+size_t historyBlockSize = 0; // Size of historyBlock
+
+Posting *trigrams = NULL; // Hash table of trigram -> commands containing it, open addressing with linear probing
+int trigramSize = 0; // Number of slots in trigrams, always a power of 2
+int trigramCount = 0; // Number of slots in use
+
+pthread_t historyLoader; // Thread reading the history file, see loadHistory()
+int historyLoading = 0; // 1 until the loader thread has been joined, see waitHistory()
+char *historyMap = NULL; // History file as it was when the shell started, read by the loader thread
+size_t historyMapSize = 0; // Size of historyMap
+char **historyPending = NULL; // Commands entered before the loader thread was joined, added to history afterwards
+int pendingCount = 0; // Number of commands in historyPending
+
+
+/* Pack the three characters at the start of text into a trigram */
+unsigned int packTrigram(char *text) {
+    unsigned char *c = (unsigned char *) text;
+    return ((c[0] << 16) | (c[1] << 8) | c[2]) + 1;
+}
+
+
+/**
+ * Find the slot for a trigram in the trigram table
+ * @param trigram The trigram, see packTrigram()
+ * @return The slot holding the trigram, or the free slot it would be stored in
+ */
+Posting *trigramSlot(unsigned int trigram) {
+    unsigned int i = (trigram * 2654435761u) & (trigramSize - 1);
+
+    while (trigrams[i].trigram != 0 && trigrams[i].trigram != trigram) { i = (i + 1) & (trigramSize - 1); }
+
+    return &trigrams[i];
+}
+
+
+/* Double the size of the trigram table, moving every posting list to its new slot */
+void trigramGrow() {
+    Posting *old = trigrams;
+    int oldSize = trigramSize;
+
+    trigramSize = (oldSize == 0) ? TRIGRAM_SIZE : oldSize * 2;
+    trigrams = calloc(trigramSize, sizeof(Posting));
+
+    for (int i = 0; i < oldSize; ++i) {
+        if (old[i].trigram != 0) { *trigramSlot(old[i].trigram) = old[i]; }
+    }
+
+    free(old);
+}
+
+
+/**
+ * Add a command to history and index each of its trigrams
+ * @param command The command, which history now owns
+ */
+void addEntry(char *command) {
+    if (historyCount == historyCapacity) {
+        historyCapacity = (historyCapacity == 0) ? 256 : historyCapacity * 2;
+        historyEntries = realloc(historyEntries, historyCapacity * sizeof(char *));
+    }
+
+    historyEntries[historyCount++] = command;
+
+    size_t length = strlen(command);
+    for (size_t i = 0; i + 3 <= length; ++i) {
+        if ((trigramCount + 1) * 2 > trigramSize) { trigramGrow(); } // Keep the table at most half full
+
+        unsigned int trigram = packTrigram(command + i);
+        Posting *posting = trigramSlot(trigram);
+
+        if (posting->trigram == 0) {
+            posting->trigram = trigram;
+            trigramCount++;
+        }
+
+        // A trigram that appears more than once in a command is only listed once
+        if (posting->count > 0 && posting->numbers[posting->count - 1] == historyCount) { continue; }
+
+        if (posting->count == posting->capacity) {
+            posting->capacity = (posting->capacity == 0) ? 4 : posting->capacity * 2;
+            posting->numbers = realloc(posting->numbers, posting->capacity * sizeof(int));
+        }
+
+        posting->numbers[posting->count++] = historyCount;
+    }
+}
+
+
+/**
+ * Run by the loader thread. Copy the history file into memory and add every command in it to history
+ * Commands point straight into the copy, so loading doesn't allocate anything per command
+ */
+void *readHistory(void *unused) {
+    (void) unused;
+    historyBlock = malloc(historyMapSize + 1);
+    memcpy(historyBlock, historyMap, historyMapSize);
+    historyBlock[historyMapSize] = '\0';
+    historyBlockSize = historyMapSize + 1;
+
+    munmap(historyMap, historyMapSize);
+    historyMap = NULL;
+
+    char *line = historyBlock;
+    char *end = historyBlock + historyMapSize;
+
+    while (line < end) {
+        char *newline = memchr(line, '\n', end - line);
+        if (newline == NULL) { newline = end; } // The last line may not have been finished
+
+        *newline = '\0';
+        if (newline > line) { addEntry(line); } // Empty lines are skipped over
+
+        line = newline + 1;
+    }
+
+    return NULL;
+}
+
+
+/* Load history the first time it is used. Scripts don't keep history, so never load it */
+void useHistory() {
+    if (!historyOpened && keepHistory) { loadHistory(); }
+}
+
+
+/* Wait for the loader thread to finish, then add any commands entered while it was running */
+void waitHistory() {
+    useHistory();
+    if (!historyLoading) { return; }
+
+    pthread_join(historyLoader, NULL);
+    historyLoading = 0;
+
+    for (int i = 0; i < pendingCount; ++i) { addEntry(historyPending[i]); }
+
+    free(historyPending);
+    historyPending = NULL;
+    pendingCount = 0;
+}
+
+
+/**
+ * Find the start of the last count lines in a block of memory, scanning backwards from the end
+ * Empty lines are skipped over
+ *
+ * @param base Start of the memory
+ * @param size Number of bytes
+ * @param starts Filled with the start of each line found, most recent first
+ * @param count Number of lines to find
+ * @return The number of lines found, at most count
+ */
+int lastLines(char *base, size_t size, char **starts, int count) {
+    char *end = base + size; // End of the line currently being looked for
+    int found = 0;
+
+    while (found < count && end > base) {
+        char *newline = memrchr(base, '\n', end - base - 1);
+        char *start = (newline == NULL) ? base : newline + 1;
+
+        if (*start != '\n') { starts[found++] = start; }
+        if (newline == NULL) { break; }
+
+        end = newline + 1;
+    }
+
+    return found;
+}
+
+
+/**
+ * Rewrite the history file to hold only its last historyKeep commands, in a child process so the user isn't kept
+ * waiting. The file is locked while it is copied, then the copy is renamed over it, so other shells either see the old
+ * file or the new one and re-open it, see appendHistory()
+ */
+void compactHistory() {
+    historyCompacting = 1;
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid != 0) { return; } // The shell carries on, the child is reaped by the SIGCHLD handler
+
+    setpgid(0, 0); // Keep out of the way of signals from the terminal
+
+    int fd = open(historyPath, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+
+    if (fd < 0 || flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0 || st.st_size == 0) { _exit(1); }
+
+    char *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) { _exit(1); }
+
+    char **starts = malloc(historyKeep * sizeof(char *));
+    int count = lastLines(base, st.st_size, starts, historyKeep);
+    char *from = (count > 0) ? starts[count - 1] : base + st.st_size; // Start of the oldest command kept
+
+    char *temp = malloc(strlen(historyPath) + 32);
+    sprintf(temp, "%s.%i", historyPath, (int) getpid());
+
+    int out = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    size_t length = base + st.st_size - from;
+
+    if (out < 0 || write(out, from, length) != (ssize_t) length || fsync(out) != 0 || rename(temp, historyPath) != 0) {
+        unlink(temp);
+        _exit(1);
+    }
+
+    _exit(0);
+}
+
+
+/**
+ * Open the history file, creating it if needed, and start a thread to load every command from it
+ * The shell doesn't wait for the thread, anything that needs history waits for it instead, see waitHistory()
+ * Called the first time history is used, or at startup with -v
+ */
+void loadHistory() {
+    if (historyOpened) { return; }
+    historyOpened = 1;
+
+    char *sync = getenv("HISTSYNC");
+    if (sync != NULL) { historySync = atoi(sync); }
+
+    char *keep = getenv("HISTKEEP");
+    if (keep != NULL && atoi(keep) > 0) { historyKeep = atoi(keep); }
+
+    historyPath = malloc(strlen(getHome()) + strlen(HISTORY_FILE) + 2);
+    sprintf(historyPath, "%s/%s", getHome(), HISTORY_FILE);
+
+    historyFd = open(historyPath, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (historyFd < 0) {
+        yellow("[Warning] ");
+        printf("Unable to open the history file %s: %s. History will not be saved\n", historyPath, strerror(errno));
+        return;
+    }
+
+    struct stat st;
+    if (fstat(historyFd, &st) != 0 || st.st_size == 0) { return; }
+    historyBytes = st.st_size;
+
+    // Commands appended from now on are added to history by the shell, so the thread only reads what is there now
+    historyMap = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, historyFd, 0);
+    if (historyMap == MAP_FAILED) {
+        historyMap = NULL;
+        return;
+    }
+    historyMapSize = st.st_size;
+
+    if (startThread(&historyLoader, readHistory) == 0) {
+        historyLoading = 1;
+    } else {
+        readHistory(NULL); // No thread, so load it now instead
+    }
+
+    if (historyKeep > 0 && historyBytes > HISTORY_COMPACT_BYTES) { compactHistory(); }
+
+    if (verbose) {
+        blue("[Info] ");
+        printf("History loaded from file\n");
+    }
+}
+
+
+/**
+ * Lock the history file so that it isn't compacted while we use it
+ * If it has been compacted since it was opened, the file we have open is no longer the history file, so open the new
+ * one instead
+ *
+ * @param operation LOCK_SH or LOCK_EX
+ * @return 0 on success, 1 if the history file could not be locked
+ */
+int lockHistory(int operation) {
+    struct stat opened, current;
+
+    for (;;) {
+        if (flock(historyFd, operation) != 0) { return 1; }
+
+        if (fstat(historyFd, &opened) == 0 && stat(historyPath, &current) == 0 &&
+            opened.st_ino == current.st_ino && opened.st_dev == current.st_dev) {
+            return 0;
+        }
+
+        // Replaced by compaction, switch over to the new file
+        int fd = open(historyPath, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            flock(historyFd, LOCK_UN);
+            return 1;
+        }
+
+        close(historyFd);
+        historyFd = fd;
+    }
+}
+
+
+/**
+ * Append a command to the history file, as a single write so that it can't be interleaved with another shell's
+ * @param command The command entered by the user, without a trailing newline
+ */
+void appendHistory(char *command) {
+    if (historyFd < 0) { return; }
+    if (lockHistory(LOCK_SH) != 0) { return; }
+
+    struct iovec line[2] = { { command, strlen(command) }, { "\n", 1 } };
+    ssize_t written = writev(historyFd, line, 2);
+
+    if (written > 0) { historyBytes += written; }
+
+    if (historySync > 0 && ++historyUnsynced >= historySync) {
+        fdatasync(historyFd);
+        historyUnsynced = 0;
+    }
+
+    flock(historyFd, LOCK_UN);
+
+    if (historyKeep > 0 && historyBytes > HISTORY_COMPACT_BYTES && !historyCompacting) { compactHistory(); }
+}
+
+
+/**
+ * Add a command to history, and to the end of the history file
+ * @param command The command entered by the user, without a trailing newline
+ */
+void addHistory(char *command) {
+    useHistory(); // Starts loading the file on the first command, it is usually ready by the next prompt
+    char *copy = strdup(command);
+
+    // History belongs to the loader thread until it has finished
+    if (historyLoading) {
+        historyPending = realloc(historyPending, (pendingCount + 1) * sizeof(char *));
+        historyPending[pendingCount++] = copy;
+    } else {
+        addEntry(copy);
+    }
+
+    appendHistory(command); // Save it straight away, so it isn't lost if the shell is killed
+}
+
+
+/**
+ * Get a command from history
+ * @param number Number of the command, starting from 1 for the oldest
+ * @return The command, or NULL if there is no command with that number
+ */
+char *getHistory(int number) {
+    waitHistory();
+
+    if (number < 1 || number > historyCount) { return NULL; }
+    return historyEntries[number - 1];
+}
+
+
+/* The number of commands in history, which is also the number of the most recent command */
+int historyLength() {
+    waitHistory();
+    return historyCount;
+}
+
+
+/**
+ * Find the commands which could contain a pattern, using the trigram index
+ * Every command containing the pattern contains each of its trigrams, so the shortest posting list of those trigrams
+ * is all that has to be checked
+ *
+ * @param pattern The text being searched for
+ * @param count Set to the number of candidates, or -1 if the pattern is too short to use the index and every command
+ *              is a candidate
+ * @return Numbers of the candidates, in increasing order
+ */
+int *historyCandidates(char *pattern, int *count) {
+    size_t length = strlen(pattern);
+
+    if (length < 3) {
+        *count = -1;
+        return NULL;
+    }
+
+    Posting *shortest = NULL;
+
+    for (size_t i = 0; i + 3 <= length; ++i) {
+        Posting *posting = (trigramSize == 0) ? NULL : trigramSlot(packTrigram(pattern + i));
+
+        // No command contains this trigram, so nothing can match
+        if (posting == NULL || posting->trigram == 0) {
+            *count = 0;
+            return NULL;
+        }
+
+        if (shortest == NULL || posting->count < shortest->count) { shortest = posting; }
+    }
+
+    *count = shortest->count;
+    return shortest->numbers;
+}
+
+
+/* Does command number match the pattern, either starting with it or containing it */
+int matchHistory(int number, char *pattern, int prefix) {
+    char *command = historyEntries[number - 1];
+
+    if (prefix) { return strncmp(command, pattern, strlen(pattern)) == 0; }
+    return strstr(command, pattern) != NULL;
+}
+
+
+/**
+ * Find the most recent command matching a pattern, e.g. for !<prefix> and !?<text>?
+ * @param pattern The text being searched for
+ * @param prefix 1 if the command has to start with the pattern, 0 if it may contain it anywhere
+ * @param before Only look at commands numbered below this, so that a search can carry on from its last match
+ * @return Number of the most recent match, or 0 if nothing matches
+ */
+int findHistory(char *pattern, int prefix, int before) {
+    waitHistory();
+
+    int count;
+    int *numbers = historyCandidates(pattern, &count);
+    int i; // Index of the first candidate to check
+
+    if (count < 0) {
+        i = ((before <= historyCount) ? before : historyCount + 1) - 2;
+    } else {
+        // Candidates are in increasing order, so skip past the ones too recent with a binary search
+        int low = 0, high = count;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (numbers[middle] < before) { low = middle + 1; } else { high = middle; }
+        }
+        i = low - 1;
+    }
+
+    for (; i >= 0; --i) {
+        int number = (count < 0) ? i + 1 : numbers[i];
+        if (matchHistory(number, pattern, prefix)) { return number; }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Display every command in history containing a pattern, along with its number, e.g. for history -s
+ * @param pattern The text being searched for
+ * @return The number of commands found
+ */
+int searchHistory(char *pattern) {
+    waitHistory();
+
+    int count, found = 0;
+    int *numbers = historyCandidates(pattern, &count);
+
+    blue(" = History Search Begin =\n");
+
+    for (int i = 0; i < ((count < 0) ? historyCount : count); ++i) {
+        int number = (count < 0) ? i + 1 : numbers[i];
+
+        if (matchHistory(number, pattern, 0)) {
+            printf(" %i\t%s\n", number, historyEntries[number - 1]);
+            found++;
+        }
+    }
+
+    blue(" = History Search End =\n");
+
+    return found;
+}
+
+
+/* Remove every command from the history file */
+void truncateHistory() {
+    if (historyFd < 0) { return; }
+    if (lockHistory(LOCK_EX) != 0) { return; }
+
+    if (ftruncate(historyFd, 0) == 0) { historyBytes = 0; }
+    flock(historyFd, LOCK_UN);
+}
+
+
+/* Remove every command from history and from the history file, e.g. for clearhistory */
+void clearHistory() {
+    waitHistory();
+
+    // Commands loaded from the file live in historyBlock, the rest were copied as they were entered
+    for (int i = 0; i < historyCount; ++i) {
+        char *command = historyEntries[i];
+        if (command < historyBlock || command >= historyBlock + historyBlockSize) { free(command); }
+    }
+
+    for (int i = 0; i < trigramSize; ++i) { free(trigrams[i].numbers); }
+
+    free(historyEntries);
+    free(historyBlock);
+    free(trigrams);
+
+    historyEntries = NULL;
+    historyBlock = NULL;
+    trigrams = NULL;
+    historyCount = historyCapacity = trigramSize = trigramCount = 0;
+    historyBlockSize = 0;
+
+    truncateHistory(); // Otherwise the commands would be loaded again next time
+
+    blue("[Info] ");
+    printf("Command History Cleared\n");
+}
+
+
+/* Sync anything not yet on disk, and close the history file */
+void closeHistory() {
+    if (historyFd < 0) { return; }
+
+    if (historySync > 0 && historyUnsynced > 0) { fdatasync(historyFd); }
+
+    close(historyFd);
+    historyFd = -1;
+}
@@ -0,0 +1,488 @@
+// Here we keep track of jobs, each job being a pipeline of one or more processes launched together
+// Children are reaped as they finish by a SIGCHLD handler, which records their status in the job table. This means
+// commands can be left running in the background, e.g. "sleep 10 &", while the user carries on entering commands.
+// Children are reaped with wait4(), so that the resources used by each job are known, see the time builtin
+
+Job jobs[MAX_JOBS]; // Job table, a slot is free when its id is 0
+volatile sig_atomic_t childrenChanged = 0; // Set by the SIGCHLD handler, so notifyJobs() only looks when it needs to
+volatile sig_atomic_t shellInterrupted = 0; // Set by Ctrl+C while the shell has the terminal, e.g. during wait
+
+
+/**
+ * Add the resources used by a process to a total, e.g. for a job. Times and counts are added together, but the maximum
+ * resident set size is the larger of the two, as the processes may not have been running at the same time
+ * This is called from the SIGCHLD handler, so must only update memory
+ *
+ * @param total The total so far
+ * @param usage The resources to add
+ */
+void addUsage(struct rusage *total, struct rusage *usage) {
+    timeradd(&total->ru_utime, &usage->ru_utime, &total->ru_utime);
+    timeradd(&total->ru_stime, &usage->ru_stime, &total->ru_stime);
+    if (usage->ru_maxrss > total->ru_maxrss) { total->ru_maxrss = usage->ru_maxrss; }
+
+    total->ru_minflt += usage->ru_minflt;
+    total->ru_majflt += usage->ru_majflt;
+    total->ru_inblock += usage->ru_inblock;
+    total->ru_oublock += usage->ru_oublock;
+    total->ru_nvcsw += usage->ru_nvcsw;
+    total->ru_nivcsw += usage->ru_nivcsw;
+}
+
+
+/**
+ * Find the job that a process belongs to, and record its new status
+ * This is called from the SIGCHLD handler, so must only update memory
+ *
+ * @param pid The process that has changed state
+ * @param status The status reported by wait4
+ * @param usage Resources used by the process, only added to the job once it has finished
+ */
+void updateJob(pid_t pid, int status, struct rusage *usage) {
+    for (int i = 0; i < MAX_JOBS; ++i) {
+        Job *job = &jobs[i];
+        if (job->id == 0) { continue; }
+
+        for (int p = 0; p < job->nProcs; ++p) {
+            if (job->pids[p] != pid) { continue; }
+
+            if (WIFSTOPPED(status)) {
+                if (!WIFSTOPPED(job->statuses[p])) { job->stopped++; }
+                job->stopSignal = WSTOPSIG(status);
+            } else if (WIFCONTINUED(status)) {
+                if (WIFSTOPPED(job->statuses[p])) { job->stopped--; }
+            } else { // Exited, or killed by a signal
+                if (WIFSTOPPED(job->statuses[p])) { job->stopped--; }
+                job->remaining--;
+                addUsage(&job->usage, usage);
+            }
+
+            job->statuses[p] = status;
+            return;
+        }
+    }
+}
+
+
+/**
+ * Send SIGCONT to a job, counting its processes as running straight away. Otherwise a job that is waited for would
+ * still look stopped until SIGCHLD reports it continued. SIGCHLD must be blocked
+ * @param job The job to continue
+ */
+void continueJob(Job *job) {
+    for (int p = 0; p < job->nProcs; ++p) {
+        if (WIFSTOPPED(job->statuses[p])) { job->statuses[p] = 0xffff; } // As reported by WCONTINUED
+    }
+
+    job->stopped = 0;
+    kill(-job->pgid, SIGCONT);
+}
+
+
+/* SIGCHLD handler, reap every child that has changed state without blocking */
+void reapChildren(int signal) {
+    int savedErrno = errno;
+    int status;
+    struct rusage usage;
+    pid_t pid;
+
+    (void) signal; // Always SIGCHLD
+
+    while ((pid = wait4(-1, &status, WNOHANG | WUNTRACED | WCONTINUED, &usage)) > 0) {
+        updateJob(pid, status, &usage);
+        childrenChanged = 1;
+    }
+
+    errno = savedErrno;
+}
+
+
+/* SIGINT handler for an interactive shell, so that Ctrl+C during a builtin such as wait ends the builtin, not the shell */
+void interruptShell(int signal) {
+    (void) signal;
+    shellInterrupted = 1;
+}
+
+
+/* Catch Ctrl+C in an interactive shell. Commands started from the shell go back to the default, see setupChild() */
+void catchInterrupts() {
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interruptShell;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+}
+
+
+/* Install the SIGCHLD handler */
+void initialiseJobs() {
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = reapChildren;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+}
+
+
+/**
+ * Block or unblock SIGCHLD. While blocked, the handler can't change the job table underneath us
+ * @param block 1 to block, 0 to unblock
+ */
+void blockChildSignal(int block) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(block ? SIG_BLOCK : SIG_UNBLOCK, &set, NULL);
+}
+
+
+/**
+ * Start a thread that never handles signals, so that the SIGCHLD handler only ever runs in the shell's own thread,
+ * where blockChildSignal() keeps it away from the job table
+ *
+ * @param thread Set to the new thread
+ * @param run Function the thread runs
+ * @return 0 on success, as for pthread_create
+ */
+int startThread(pthread_t *thread, void *(*run)(void *)) {
+    sigset_t all, saved;
+    sigfillset(&all);
+
+    pthread_sigmask(SIG_SETMASK, &all, &saved); // The new thread inherits this mask
+    int result = pthread_create(thread, NULL, run, NULL);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    return result;
+}
+
+
+/**
+ * Create a new job for a pipeline which is about to be launched
+ * The job's id is one more than the highest id in use, as in other shells
+ *
+ * @param pipeline The pipeline that will be run, used to build up the command shown to the user
+ * @param background 1 if the job is being run in the background
+ * @return The new job, or NULL if the job table is full
+ */
+Job *newJob(Pipeline *pipeline, int background) {
+    Job *job = NULL;
+    int id = 1;
+
+    for (int i = 0; i < MAX_JOBS; ++i) {
+        if (jobs[i].id == 0 && job == NULL) { job = &jobs[i]; }
+        if (jobs[i].id >= id) { id = jobs[i].id + 1; }
+    }
+
+    if (job == NULL) {
+        red("[Error] ");
+        printf("Too many jobs, the maximum is %i. Please wait for some to finish\n", MAX_JOBS);
+        return NULL;
+    }
+
+    memset(job, 0, sizeof(Job));
+    job->id = id;
+    job->foreground = !background;
+
+    // Rebuild the command line from each stage, e.g. "sleep 10 | cat"
+    for (int s = 0; s < pipeline->nStages; ++s) {
+        if (s > 0) { strncat(job->command, " |", MAX_JOB_COMMAND - strlen(job->command) - 1); }
+
+        for (int a = 0; pipeline->stages[s].argv[a] != NULL; ++a) {
+            if (s > 0 || a > 0) { strncat(job->command, " ", MAX_JOB_COMMAND - strlen(job->command) - 1); }
+            strncat(job->command, pipeline->stages[s].argv[a], MAX_JOB_COMMAND - strlen(job->command) - 1);
+        }
+    }
+
+    return job;
+}
+
+
+/**
+ * Add a process that has just been launched to a job
+ * @param job The job the process belongs to
+ * @param pid The new process
+ */
+void addToJob(Job *job, pid_t pid) {
+    if (job->nProcs == 0) { job->pgid = pid; } // The first process leads the job's process group
+
+    job->pids[job->nProcs] = pid;
+    job->statuses[job->nProcs] = 0;
+    job->nProcs++;
+    job->remaining++;
+}
+
+
+/**
+ * Return the exit status of a finished job, which is the status of its last process
+ * @param job The job
+ * @return The exit status, or 128 + the signal number if the process was killed by a signal
+ */
+int jobStatus(Job *job) {
+    int status = job->statuses[job->nProcs - 1];
+
+    if (WIFSIGNALED(status)) { return 128 + WTERMSIG(status); }
+    return WEXITSTATUS(status);
+}
+
+
+/* Display a job, e.g. "[1] Running    sleep 10", or "[1] Killed    sleep 10" if it was ended by a signal */
+void dispJob(Job *job) {
+    char *state = "Running";
+    int last = job->statuses[job->nProcs - 1];
+    if (job->remaining == 0 && WIFSIGNALED(last)) { state = strsignal(WTERMSIG(last)); }
+    else if (job->remaining == 0) { state = "Done"; }
+    else if (job->stopped > 0) { state = "Stopped"; }
+
+    printf("[%i] %s\t%s\n", job->id, state, job->command);
+}
+
+
+/**
+ * Wait in the foreground for a job to finish or be stopped, e.g. by Ctrl+Z
+ * The job is given the terminal while we wait, and then we take it back
+ *
+ * @param job The job to wait for
+ * @return The exit status of the job, or 128 + the signal number if it was stopped
+ */
+int waitForJob(Job *job) {
+    sigset_t waiting; // Signal mask to use while waiting, with SIGCHLD unblocked
+    sigprocmask(SIG_SETMASK, NULL, &waiting);
+    sigdelset(&waiting, SIGCHLD);
+
+    job->foreground = 1;
+    if (shellTerminal >= 0) { tcsetpgrp(shellTerminal, job->pgid); }
+
+    while (job->remaining > 0) {
+        // Stopped by reading the terminal before it was handed over, let it carry on now that it has it
+        if (job->stopped > 0 && (job->stopSignal == SIGTTIN || job->stopSignal == SIGTTOU)) {
+            job->stopSignal = 0;
+            continueJob(job);
+        } else if (job->stopped > 0 && job->stopped == job->remaining) {
+            break;
+        }
+
+        sigsuspend(&waiting); // Sleep until SIGCHLD has been handled
+    }
+
+    job->foreground = 0;
+    if (shellTerminal >= 0) { tcsetpgrp(shellTerminal, getpgrp()); } // Take back the terminal
+
+    lastJobUsage = job->usage; // Only processes that have finished, if the job was stopped
+    jobsWaited++;
+
+    // Stopped, leave it in the job table so it can be continued with fg or bg
+    if (job->remaining > 0) {
+        printf("\n");
+        dispJob(job);
+        return 128 + job->stopSignal;
+    }
+
+    int status = jobStatus(job);
+    int last = job->statuses[job->nProcs - 1];
+
+    if (WIFSIGNALED(last) && WTERMSIG(last) != SIGINT && WTERMSIG(last) != SIGPIPE) {
+        yellow("[Warning] ");
+        printf("%s%s\n", strsignal(WTERMSIG(last)), WCOREDUMP(last) ? " (core dumped)" : "");
+    }
+
+    job->id = 0; // Free the slot
+    return status;
+}
+
+
+/* Display each background job that has finished, then remove it from the job table */
+void notifyJobs() {
+    if (!childrenChanged) { return; } // Nothing has finished since we last looked
+
+    blockChildSignal(1);
+    childrenChanged = 0;
+
+    for (int i = 0; i < MAX_JOBS; ++i) {
+        if (jobs[i].id != 0 && !jobs[i].foreground && jobs[i].remaining == 0) {
+            dispJob(&jobs[i]);
+            jobs[i].id = 0;
+        }
+    }
+
+    blockChildSignal(0);
+}
+
+
+/* Display every job in the job table, finished jobs are then removed */
+void dispJobs() {
+    blockChildSignal(1);
+
+    for (int i = 0; i < MAX_JOBS; ++i) {
+        if (jobs[i].id != 0) { dispJob(&jobs[i]); }
+        if (jobs[i].remaining == 0) { jobs[i].id = 0; }
+    }
+
+    blockChildSignal(0);
+}
+
+
+/**
+ * Find a job from a job spec entered by the user, e.g. "%1" or "1"
+ * With no spec, the most recently started job is used
+ * SIGCHLD should be blocked
+ *
+ * @param spec The job spec, or NULL
+ * @return The job, or NULL if there is no such job. An error will have been displayed
+ */
+Job *findJob(char *spec) {
+    Job *found = NULL;
+    int id = 0;
+
+    if (spec != NULL) {
+        char *end;
+        id = strtol(spec[0] == '%' ? spec + 1 : spec, &end, 10);
+
+        if (*end != 0 || id <= 0) {
+            red("[Error] ");
+            printf("\"%s\" is not a valid job. Try calling \"jobs\" to see the current jobs\n", spec);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < MAX_JOBS; ++i) {
+        if (jobs[i].id == 0) { continue; }
+        if (id == 0 && (found == NULL || jobs[i].id > found->id)) { found = &jobs[i]; }
+        if (id != 0 && jobs[i].id == id) { found = &jobs[i]; }
+    }
+
+    if (found == NULL) {
+        red("[Error] ");
+        if (spec == NULL) { printf("There are no jobs\n"); }
+        else { printf("There is no job %s. Try calling \"jobs\" to see the current jobs\n", spec); }
+    }
+
+    return found;
+}
+
+
+/**
+ * Continue a job in the foreground, and wait for it
+ * @param spec The job to continue, or NULL for the most recent job
+ * @return The exit status of the job
+ */
+int foregroundJob(char *spec) {
+    blockChildSignal(1);
+
+    Job *job = findJob(spec);
+    if (job == NULL) {
+        blockChildSignal(0);
+        return 1;
+    }
+
+    printf("%s\n", job->command);
+    fflush(stdout);
+
+    if (shellTerminal >= 0) { tcsetpgrp(shellTerminal, job->pgid); }
+    continueJob(job);
+
+    int status = waitForJob(job);
+    blockChildSignal(0);
+
+    return status;
+}
+
+
+/**
+ * Continue a stopped job in the background
+ * @param spec The job to continue, or NULL for the most recent job
+ * @return 0 on success, 1 if there is no such job
+ */
+int backgroundJob(char *spec) {
+    blockChildSignal(1);
+
+    Job *job = findJob(spec);
+    if (job != NULL) {
+        continueJob(job);
+        printf("[%i] %s &\n", job->id, job->command);
+    }
+
+    blockChildSignal(0);
+    return job == NULL;
+}
+
+
+/**
+ * Wait for a background job to finish, or for every job to finish if no job is given
+ * Stopped jobs are not waited for, as they would never finish. Ctrl+C stops waiting, leaving the jobs running
+ *
+ * @param spec The job to wait for, or NULL for all jobs
+ * @return The exit status of the job waited for, 0 when waiting for every job, or 130 if interrupted by Ctrl+C
+ */
+int waitJobs(char *spec) {
+    sigset_t waiting;
+    int status = 0;
+
+    blockChildSignal(1);
+    sigprocmask(SIG_SETMASK, NULL, &waiting);
+    sigdelset(&waiting, SIGCHLD);
+
+    Job *job = (spec != NULL) ? findJob(spec) : NULL;
+    if (spec != NULL && job == NULL) {
+        blockChildSignal(0);
+        return 127;
+    }
+
+    shellInterrupted = 0;
+
+    for (;;) {
+        int busy = 0; // Number of jobs still being waited for
+
+        for (int i = 0; i < MAX_JOBS; ++i) {
+            if (jobs[i].id == 0 || (job != NULL && &jobs[i] != job)) { continue; }
+            if (jobs[i].remaining > 0 && jobs[i].stopped < jobs[i].remaining) { busy++; }
+        }
+
+        if (busy == 0 || shellInterrupted) { break; }
+        sigsuspend(&waiting); // Returns once SIGCHLD or SIGINT has been handled
+    }
+
+    if (shellInterrupted) {
+        blockChildSignal(0);
+        printf("\n");
+        return 128 + SIGINT;
+    }
+
+    if (job != NULL && job->remaining == 0) {
+        status = jobStatus(job);
+        job->id = 0;
+    }
+
+    blockChildSignal(0);
+    return status;
+}
+
+
+/* Number of jobs, running or stopped. Only the shell frees job slots, so SIGCHLD doesn't need to be blocked */
+int countJobs() {
+    int count = 0;
+
+    for (int i = 0; i < MAX_JOBS; ++i) {
+        if (jobs[i].id != 0) { count++; }
+    }
+
+    return count;
+}
+
+
+/* Send SIGHUP to every job left when the shell exits, continuing stopped jobs so that they receive it */
+void hangupJobs() {
+    blockChildSignal(1);
+
+    for (int i = 0; i < MAX_JOBS; ++i) {
+        if (jobs[i].id != 0 && jobs[i].remaining > 0) {
+            kill(-jobs[i].pgid, SIGHUP);
+            if (jobs[i].stopped > 0) { kill(-jobs[i].pgid, SIGCONT); }
+        }
+    }
+
+    blockChildSignal(0);
+}
\ No newline at end of file
@@ -0,0 +1,327 @@
+// Here we define how external commands are started. There are four launch modes:
+//      fork  - Copy the shell with fork(), then exec the command in the child. Cost grows with the size of the shell
+//      vfork - The child borrows the shell's memory until it execs, so the cost does not depend on the shell's size
+//      spawn - Let the C library start the command with posix_spawn(), which uses the cheapest method it has (Default)
+//      zygote - Ask a small helper forked when the shell started to start the command, see zygote.c and -z
+
+typedef enum { LAUNCH_FORK, LAUNCH_VFORK, LAUNCH_SPAWN, LAUNCH_ZYGOTE } LaunchMode;
+
+char *LAUNCH_MODES[] = { "fork", "vfork", "spawn", "zygote" }; // Names of each launch mode, as used by the launcher builtin
+LaunchMode launchMode = LAUNCH_SPAWN; // Method currently used to launch new processes
+
+extern char **environ;
+
+
+/**
+ * Return the file descriptor that a redirection replaces, and the flags used to open its target
+ * @param type The type of redirection, e.g. OP_APPEND
+ * @param flags Set to the flags to open the target with
+ * @return The file descriptor being redirected, e.g. 1 for stdout
+ */
+int redirectFd(Operator type, int *flags) {
+    switch (type) {
+        case OP_IN: *flags = O_RDONLY; return STDIN_FILENO;
+        case OP_OUT: *flags = O_WRONLY | O_CREAT | O_TRUNC; return STDOUT_FILENO;
+        case OP_APPEND: *flags = O_WRONLY | O_CREAT | O_APPEND; return STDOUT_FILENO;
+        case OP_ERR_OUT: *flags = O_WRONLY | O_CREAT | O_TRUNC; return STDERR_FILENO;
+        case OP_ERR_APPEND: *flags = O_WRONLY | O_CREAT | O_APPEND; return STDERR_FILENO;
+        default: *flags = 0; return STDERR_FILENO; // 2>&1
+    }
+}
+
+
+/**
+ * Open the target of each redirection and move it into place, in the order they were entered
+ * This only makes system calls, so that it is safe to call from a vfork child
+ *
+ * @param redirects The redirections to apply
+ * @param n The number of redirections
+ * @return -1 on success, otherwise the index of the redirection that failed, with errno set
+ */
+int applyRedirects(Redirect *redirects, int n) {
+    for (int i = 0; i < n; ++i) {
+        int flags;
+        int fd = redirectFd(redirects[i].type, &flags);
+
+        // 2>&1, stderr goes wherever stdout currently goes
+        if (redirects[i].type == OP_ERR_TO_OUT) {
+            if (dup2(STDOUT_FILENO, STDERR_FILENO) < 0) { return i; }
+            continue;
+        }
+
+        int file = open(redirects[i].target, flags | O_CLOEXEC, 0666);
+        if (file < 0 || dup2(file, fd) < 0) { return i; }
+        close(file);
+    }
+
+    return -1;
+}
+
+
+/**
+ * Open the target of each redirection in the shell, so that every launch mode reports a missing file the same way,
+ * and work out what the child's stdin, stdout and stderr should be, in the order the redirections were entered
+ *
+ * @param io File descriptors and redirections for the child
+ * @param fds Set to the file descriptors the child should have as its stdin, stdout and stderr
+ * @param opened Filled with the file descriptors opened here, to be closed once the child has been started
+ * @param nOpened Set to the number of file descriptors in opened
+ * @return 0 on success, 1 if a target couldn't be opened. An error will have been displayed
+ */
+int openRedirects(LaunchIO *io, int fds[3], int opened[MAX_REDIRECTS + 3], int *nOpened) {
+    fds[STDIN_FILENO] = (io->in >= 0) ? io->in : STDIN_FILENO;
+    fds[STDOUT_FILENO] = (io->out >= 0) ? io->out : STDOUT_FILENO;
+    fds[STDERR_FILENO] = (io->err >= 0) ? io->err : STDERR_FILENO;
+    *nOpened = 0;
+
+    for (int i = 0; i < io->nRedirects; ++i) {
+        int flags;
+        int fd = redirectFd(io->redirects[i].type, &flags);
+
+        // 2>&1, stderr goes wherever stdout currently goes
+        if (io->redirects[i].type == OP_ERR_TO_OUT) {
+            fds[STDERR_FILENO] = fds[STDOUT_FILENO];
+            continue;
+        }
+
+        int file = open(io->redirects[i].target, flags | O_CLOEXEC, 0666);
+
+        if (file < 0) {
+            int error = errno;
+            for (int o = 0; o < *nOpened; ++o) { close(opened[o]); }
+            red("[Error] ");
+            printf("%s: %s\n", io->redirects[i].target, strerror(error));
+            return 1;
+        }
+
+        fds[fd] = opened[(*nOpened)++] = file;
+    }
+
+    // One of the shell's own stdin, stdout or stderr in another position, e.g. stdout as stderr after 2>&1, would be
+    // replaced before it is copied when the child moves its file descriptors into place, so use a copy of it instead
+    for (int fd = 0; fd < 3; ++fd) {
+        if (fds[fd] < 3 && fds[fd] != fd) { fds[fd] = opened[(*nOpened)++] = fcntl(fds[fd], F_DUPFD_CLOEXEC, 3); }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Prepare a forked child before it execs: join the process group, take the terminal if the shell has one and this is
+ * a foreground command, then move its stdin, stdout and stderr into place. Only system calls are made here so that
+ * this is safe to call from a vfork child
+ *
+ * @param io Process group for the child, and whether it is in the foreground
+ * @param fds File descriptors to use as the child's stdin, stdout and stderr, see openRedirects()
+ */
+void setupChild(LaunchIO *io, int fds[3]) {
+    sigset_t none;
+    sigemptyset(&none);
+
+    setpgid(0, io->pgid);
+
+    if (io->foreground && shellTerminal >= 0) { tcsetpgrp(shellTerminal, getpgrp()); }
+
+    // The shell ignores job control signals and blocks SIGCHLD while launching, the command should not inherit that
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    if (shellTerminal >= 0) { signal(SIGINT, SIG_DFL); } // Caught by the shell, see catchInterrupts()
+    sigprocmask(SIG_SETMASK, &none, NULL);
+
+    for (int fd = 0; fd < 3; ++fd) {
+        if (fds[fd] != fd) { dup2(fds[fd], fd); }
+    }
+}
+
+
+/**
+ * Start a new process running path with the arguments argv, without waiting for it to finish
+ * The new process is placed into a process group, and given the terminal if the shell has one
+ *
+ * @param path Path to the executable, as found by hashLookup
+ * @param argv NULL terminated list of arguments, argv[0] being the command name
+ * @param io File descriptors to connect to the new process and the process group it should join
+ * @return The pid of the new process, -2 if a redirection couldn't be opened, or -1 if the process couldn't be
+ *         started. An error will have been displayed
+ */
+pid_t launchProcess(char *path, char **argv, LaunchIO *io) {
+    pid_t pid;
+    volatile int childErrno = 0; // Shared with a vfork child so it can tell us why exec failed
+    int fds[3]; // The child's stdin, stdout and stderr
+    int opened[MAX_REDIRECTS + 3]; // File descriptors opened for the child, closed once it has started
+    int nOpened;
+
+    if (openRedirects(io, fds, opened, &nOpened) != 0) { return -2; }
+
+    fflush(stdout); // Don't let the child inherit (and repeat) anything waiting to be printed
+
+    switch (launchMode) {
+        case LAUNCH_ZYGOTE: {
+            int error;
+            pid = zygoteLaunch(path, argv, io, fds, &error);
+            childErrno = error;
+
+            if (pid >= 0 || launchMode == LAUNCH_ZYGOTE) { break; }
+            fflush(stdout); // The zygote has gone, launch with spawn instead
+        }
+        // fall through
+
+        case LAUNCH_SPAWN: {
+            posix_spawnattr_t attr;
+            posix_spawn_file_actions_t actions;
+            sigset_t defaults, none;
+
+            posix_spawnattr_init(&attr);
+            posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+            posix_spawnattr_setpgroup(&attr, io->pgid);
+            sigemptyset(&defaults);
+            sigaddset(&defaults, SIGTSTP);
+            sigaddset(&defaults, SIGTTIN);
+            sigaddset(&defaults, SIGTTOU);
+            posix_spawnattr_setsigdefault(&attr, &defaults);
+            sigemptyset(&none);
+            posix_spawnattr_setsigmask(&attr, &none);
+
+            posix_spawn_file_actions_init(&actions);
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 35)
+            if (io->foreground && shellTerminal >= 0) { posix_spawn_file_actions_addtcsetpgrp_np(&actions, shellTerminal); }
+#endif
+            for (int fd = 0; fd < 3; ++fd) {
+                if (fds[fd] != fd) { posix_spawn_file_actions_adddup2(&actions, fds[fd], fd); }
+            }
+
+            childErrno = posix_spawn(&pid, path, &actions, &attr, argv, environ);
+            if (childErrno != 0) { pid = -1; }
+
+            posix_spawn_file_actions_destroy(&actions);
+            posix_spawnattr_destroy(&attr);
+            break;
+        }
+
+        case LAUNCH_VFORK:
+            pid = vfork();
+            if (pid == 0) { // Child process, only system calls, exec or _exit are safe here
+                setupChild(io, fds);
+                execv(path, argv);
+                childErrno = errno;
+                _exit(127);
+            }
+            if (pid < 0) { childErrno = errno; }
+            break;
+
+        case LAUNCH_FORK:
+        default:
+            pid = fork();
+            if (pid == 0) { // Child process
+                setupChild(io, fds);
+                execv(path, argv);
+                red("[Error] ");
+                printf("Unable to execute %s: %s\n", path, strerror(errno));
+                fflush(stdout);
+                _exit(127);
+            }
+            if (pid < 0) { childErrno = errno; }
+            break;
+    }
+
+    for (int i = 0; i < nOpened; ++i) { close(opened[i]); }
+
+    // A vfork or zygote child that failed to exec will already have exited, reap it here and report the error
+    if (pid > 0 && childErrno != 0) {
+        waitpid(pid, NULL, 0);
+        pid = -1;
+    }
+
+    if (pid < 0) {
+        red("[Error] ");
+        printf("Error spawning child process for %s: %s\n", argv[0], strerror(childErrno));
+        return -1;
+    }
+
+    // Also set the process group from the parent, so that it is in place whichever process runs first
+    setpgid(pid, io->pgid == 0 ? pid : io->pgid);
+
+    return pid;
+}
+
+
+/**
+ * Start a builtin as one stage of a pipeline, e.g. "history | grep make", in a child process of its own so that it can
+ * run at the same time as the other stages. As in a subshell, anything the builtin changes, e.g. with cd, only changes
+ * the child
+ *
+ * @param builtin The builtin to run
+ * @param argv NULL terminated list of arguments, argv[0] being the name of the builtin
+ * @param io File descriptors to connect to the child and the process group it should join
+ * @return The pid of the child, -2 if a redirection couldn't be opened, or -1 if it couldn't be started. An error will
+ *         have been displayed
+ */
+pid_t launchBuiltin(Builtin *builtin, char **argv, LaunchIO *io) {
+    int fds[3]; // The child's stdin, stdout and stderr
+    int opened[MAX_REDIRECTS + 3]; // File descriptors opened for the child, closed once it has started
+    int nOpened;
+
+    if (openRedirects(io, fds, opened, &nOpened) != 0) { return -2; }
+
+    // The child can't wait for a thread of the shell's, so finish loading history first in case the builtin needs it
+    if (historyLoading) { waitHistory(); }
+
+    fflush(stdout); // Don't let the child inherit (and repeat) anything waiting to be printed
+    pid_t pid = fork();
+
+    if (pid == 0) { // Child process
+        setupChild(io, fds);
+
+        int argc = 0;
+        while (argv[argc] != NULL) { argc++; }
+
+        int status = runBuiltin(builtin, argc, argv);
+        fflush(stdout);
+        _exit(status);
+    }
+
+    for (int i = 0; i < nOpened; ++i) { close(opened[i]); }
+
+    if (pid < 0) {
+        red("[Error] ");
+        printf("Error spawning child process for %s: %s\n", argv[0], strerror(errno));
+        return -1;
+    }
+
+    // Also set the process group from the parent, so that it is in place whichever process runs first
+    setpgid(pid, io->pgid == 0 ? pid : io->pgid);
+
+    return pid;
+}
+
+
+/**
+ * Change the launch mode
+ * @param mode Name of the new mode, one of fork, vfork, spawn or zygote. The zygote is started if it isn't running
+ * @return 0 on success, 1 if the mode is not recognised
+ */
+int setLaunchMode(char *mode) {
+    for (int i = 0; i < (int) (sizeof(LAUNCH_MODES) / sizeof(LAUNCH_MODES[0])); ++i) {
+        if (strcmp(mode, LAUNCH_MODES[i]) == 0) {
+            if (i == LAUNCH_ZYGOTE && startZygote() != 0) { return 1; }
+
+            launchMode = i;
+            blue("[Info] ");
+            printf("Commands will now be launched using %s\n", LAUNCH_MODES[i]);
+            return 0;
+        }
+    }
+
+    red("[Error] ");
+    printf("Unknown launch mode \"%s\". Please use one of fork, vfork, spawn or zygote\n", mode);
+    return 1;
+}
+
+
+/* Display the current launch mode */
+void displayLaunchMode() {
+    blue("[Info] ");
+    printf("Commands are launched using %s\n", LAUNCH_MODES[launchMode]);
+}
\ No newline at end of file
@@ -0,0 +1,272 @@
+// Here we split a line entered by the user into tokens, in a single pass over the line
+// Words are separated by DELIMITERS, except inside quotes. Quotes and backslashes are removed as we go, so each word is
+// written back over the line itself, and the tokens point straight into the line. Nothing is allocated apart from
+// growing the tokens array, and all state is kept on the stack, so a line can be lexed while another is part way
+// through, e.g. when expanding an alias
+//      'single quotes'     Everything inside is taken literally
+//      "double quotes"     Everything inside is taken literally, except \" \\ \$ and \` which are escaped
+//      \<character>        The character is taken literally, e.g. \| or \  (A space)
+//      $?                  The exit status of the last command, outside quotes or in double quotes. This is left as
+//                          STATUS_MARK, and replaced just before the command runs, see expandStatus()
+//      * ? [               Globs, outside quotes. These are left as GLOB_STAR, GLOB_ONE and GLOB_CLASS, and expanded
+//                          into the paths they match just before the command runs, see glob.c
+// Operators such as | and > are recognised outside of quotes, and are represented by pointers into OPERATORS, see
+// operatorType()
+// Long lines, e.g. rm with hundreds of files, are mostly plain characters, so runs of them are found with SIMD
+// instructions where available and copied in one go, rather than looking at one character at a time
+
+#define WORD_SPECIAL " \t;\n\"'\\|<>&$*?[" /* Characters that end a run of plain characters outside quotes */
+#define DOUBLE_SPECIAL "\"\\$" /* Characters that end a run of plain characters inside double quotes */
+#define SINGLE_SPECIAL "'" /* Characters that end a run of plain characters inside single quotes */
+
+
+Needles wordNeedles; // WORD_SPECIAL, built by initialiseLexer()
+Needles doubleNeedles; // DOUBLE_SPECIAL, built by initialiseLexer()
+Needles singleNeedles; // SINGLE_SPECIAL, built by initialiseLexer()
+
+
+/* Fill in needles for a set of characters, repeating each character across a whole register */
+void buildNeedles(Needles *needles, const char *special) {
+    needles->special = special;
+    needles->nWanted = 0;
+
+    for (const char *s = special; *s; ++s) {
+#if defined(__AVX2__)
+        needles->wanted[needles->nWanted++] = _mm256_set1_epi8(*s);
+#elif defined(__SSE2__)
+        needles->wanted[needles->nWanted++] = _mm_set1_epi8(*s);
+#endif
+    }
+}
+
+
+/* Build the needles that scanPlain() looks for, once at startup rather than on every run of plain characters */
+void initialiseLexer() {
+    buildNeedles(&wordNeedles, WORD_SPECIAL);
+    buildNeedles(&doubleNeedles, DOUBLE_SPECIAL);
+    buildNeedles(&singleNeedles, SINGLE_SPECIAL);
+}
+
+
+/**
+ * Find the first character in position that is one of the needles, or the end of the string
+ * This is strcspn(), but vectorised over 32 (AVX2) or 16 (SSE2) characters at a time. Loads are aligned so that they
+ * never cross into a page that might not be mapped, which means reading a little before position and past the NUL
+ *
+ * @param position Where to start looking
+ * @param needles The characters to look for, see initialiseLexer()
+ * @return Pointer to the first special character, or to the NUL at the end of the string
+ */
+char *scanPlain(char *position, const Needles *needles) {
+#if defined(__AVX2__)
+    uintptr_t offset = (uintptr_t) position & 31;
+    char *block = position - offset;
+    unsigned int skip = 0xFFFFFFFFu << offset; // Ignore characters before position in the first block
+
+    for (;; block += 32, skip = 0xFFFFFFFFu) {
+        __m256i chars = _mm256_load_si256((__m256i *) block);
+        __m256i found = _mm256_cmpeq_epi8(chars, _mm256_setzero_si256());
+
+        for (int i = 0; i < needles->nWanted; ++i) {
+            found = _mm256_or_si256(found, _mm256_cmpeq_epi8(chars, needles->wanted[i]));
+        }
+
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(found) & skip;
+        if (mask) { return block + __builtin_ctz(mask); }
+    }
+#elif defined(__SSE2__)
+    uintptr_t offset = (uintptr_t) position & 15;
+    char *block = position - offset;
+    unsigned int skip = 0xFFFFu << offset; // Ignore characters before position in the first block
+
+    for (;; block += 16, skip = 0xFFFFu) {
+        __m128i chars = _mm_load_si128((__m128i *) block);
+        __m128i found = _mm_cmpeq_epi8(chars, _mm_setzero_si128());
+
+        for (int i = 0; i < needles->nWanted; ++i) {
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(chars, needles->wanted[i]));
+        }
+
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(found) & skip;
+        if (mask) { return block + __builtin_ctz(mask); }
+    }
+#else
+    return position + strcspn(position, needles->special);
+#endif
+}
+
+
+/**
+ * Copy a run of plain characters from r to w, returning the new r. w is advanced past the characters copied
+ * @param r Where to read from
+ * @param w Where to write to, never ahead of r
+ * @param needles Characters that end the run, see scanPlain()
+ */
+char *copyPlain(char *r, char **w, const Needles *needles) {
+    char *end = scanPlain(r, needles);
+    size_t length = end - r;
+
+    if (*w != r) { memmove(*w, r, length); }
+    *w += length;
+
+    return end;
+}
+
+
+/**
+ * Add a token to the tokens array, growing it if needed
+ * @param tokens The tokens array, may be moved
+ * @param capacity Number of tokens the array can hold, not counting the NULL at the end
+ * @param count Number of tokens already in the array
+ * @param token The token to add
+ */
+void addToken(char ***tokens, int *capacity, int count, char *token) {
+    if (count >= *capacity) {
+        *capacity *= 2;
+        *tokens = realloc(*tokens, (*capacity + 1) * sizeof(char *));
+    }
+
+    (*tokens)[count] = token;
+}
+
+
+/**
+ * Lex a line into tokens. The line is modified in place
+ *
+ * @param line The line to lex, NUL terminated
+ * @param tokens Filled with the tokens found, NULL terminated. Grown with realloc() if there are more than capacity
+ * @param capacity Number of tokens that tokens can hold, not counting the NULL at the end. Updated if tokens grows
+ * @return The number of tokens, or -1 if a quote was not closed. An error will have been displayed
+ */
+int lexLine(char *line, char ***tokens, int *capacity) {
+    char *r = line; // Next character to read
+    char *w = line; // Where the next character of the current word should be written. Never ahead of r
+    char *word = NULL; // Start of the current word, or NULL if we are between words
+    char quote = 0; // The quote we are inside, or 0
+    int count = 0;
+
+    for (;;) {
+        char c = *r;
+
+        // Inside quotes, copy everything up to the closing quote
+        if (quote) {
+            if (c == 0) {
+                red("[Error] ");
+                printf("Missing closing %c. Please close the quote and try again\n", quote);
+                return -1;
+            }
+
+            if (c == quote) {
+                quote = 0;
+                r++;
+            } else if (c == '\\' && quote == '"' && r[1] != 0 && strchr("\"\\$`", r[1])) {
+                *w++ = r[1];
+                r += 2;
+            } else if (c == '$' && r[1] == '?' && quote == '"') {
+                *w++ = STATUS_MARK;
+                r += 2;
+            } else if (c == '\\' || c == '$') {
+                *w++ = *r++;
+            } else {
+                r = copyPlain(r, &w, quote == '"' ? &doubleNeedles : &singleNeedles);
+            }
+            continue;
+        }
+
+        int length = 0;
+        Operator op = OP_NONE;
+
+        // Only characters that can begin an operator are checked, as matchOperator() tries every operator in turn
+        if (c == '|' || c == '<' || c == '>' || c == '&' || c == ';' || c == '2') {
+            op = matchOperator(r, word == NULL || w == word, &length);
+        }
+
+        // End of a word, either a delimiter, an operator or the end of the line
+        if (c == 0 || strchr(DELIMITERS, c) || op != OP_NONE) {
+            if (word != NULL) {
+                *w = 0;
+                addToken(tokens, capacity, count++, word);
+                word = NULL;
+            }
+
+            if (op != OP_NONE) { addToken(tokens, capacity, count++, OPERATORS[op - 1]); }
+
+            if (c == 0) { break; }
+
+            r += (op != OP_NONE) ? length : 1;
+            w = r;
+            continue;
+        }
+
+        // Part of a word
+        if (word == NULL) { word = w; }
+
+        if (c == '"' || c == '\'') {
+            quote = c;
+            r++;
+        } else if (c == '\\' && r[1] != 0) {
+            *w++ = r[1];
+            r += 2;
+        } else if (c == '$' && r[1] == '?') {
+            *w++ = STATUS_MARK;
+            r += 2;
+        } else if (c == '*' || c == '?' || c == '[') {
+            *w++ = (c == '*') ? GLOB_STAR : (c == '?') ? GLOB_ONE : GLOB_CLASS;
+            r++;
+        } else if (strchr(WORD_SPECIAL, c)) { // A lone backslash at the end of the line, or an operator character
+            *w++ = *r++;
+        } else {
+            r = copyPlain(r, &w, &wordNeedles);
+        }
+    }
+
+    (*tokens)[count] = NULL;
+    return count;
+}
+
+
+/**
+ * Replace each $? left in the tokens by lexLine() with the exit status of the last command
+ * Tokens that change are copied into a single block of memory, the rest are left where they are
+ *
+ * @param tokens The tokens of the command about to run
+ * @param n Number of tokens
+ * @param status The exit status of the last command
+ * @return The block holding the changed tokens, to be freed once they are no longer needed, or NULL if nothing changed
+ */
+char *expandStatus(char *tokens[], int n, int status) {
+    char number[16];
+    int numberLength = sprintf(number, "%i", status);
+    size_t size = 0;
+
+    for (int i = 0; i < n; ++i) {
+        if (strchr(tokens[i], STATUS_MARK) == NULL) { continue; }
+
+        for (char *r = tokens[i]; *r; ++r) { size += (*r == STATUS_MARK) ? numberLength : 1; }
+        size++;
+    }
+
+    if (size == 0) { return NULL; }
+
+    char *block = malloc(size);
+    char *w = block;
+
+    for (int i = 0; i < n; ++i) {
+        if (strchr(tokens[i], STATUS_MARK) == NULL) { continue; }
+
+        char *token = w;
+        for (char *r = tokens[i]; *r; ++r) {
+            if (*r == STATUS_MARK) {
+                memcpy(w, number, numberLength);
+                w += numberLength;
+            } else {
+                *w++ = *r;
+            }
+        }
+
+        *w++ = 0;
+        tokens[i] = token;
+    }
+
+    return block;
+}
@@ -0,0 +1,419 @@
+// Here we run a command over many arguments at once, e.g. "parallel gzip ::: a.log b.log c.log"
+// Arguments are packed into as few commands as possible, as xargs does, while still giving every worker something to
+// do. Each command is launched like any other system command and tracked in the job table. Its output and errors are
+// collected through a pipe each and printed to stdout and stderr once it finishes, so that commands running together
+// don't garble each other
+
+
+/* Bytes of arguments a command can be given, which is ARG_MAX less the environment, leaving some spare as xargs does */
+long argumentSpace() {
+    long space = sysconf(_SC_ARG_MAX);
+    if (space <= 0) { space = _POSIX_ARG_MAX; }
+
+    for (char **variable = environ; *variable != NULL; ++variable) {
+        space -= strlen(*variable) + 1 + sizeof(char *);
+    }
+
+    return space - 2048;
+}
+
+
+/**
+ * Read a number of workers or arguments given to an option, such as "-j 4"
+ * @param text The number as entered
+ * @param option The option it was given to, for the error message
+ * @return The number, or -1 if it isn't a positive number. An error will have been displayed
+ */
+int parseCount(char *text, char *option) {
+    char *end;
+    long count = strtol(text, &end, 10);
+
+    if (*end != 0 || count <= 0 || count > INT_MAX) {
+        red("[Error] ");
+        printf("\"%s\" is not a valid number for %s. Please enter a whole number greater than 0\n", text, option);
+        return -1;
+    }
+
+    return count;
+}
+
+
+/**
+ * Read arguments from stdin, one per line, for when none are given after :::
+ * Empty lines are skipped. Read with read() rather than stdio, as stdin may be the script the shell is running
+ *
+ * @param text Set to the text read, which the arguments point into. Free it once the arguments are no longer needed
+ * @param count Set to the number of arguments
+ * @return The arguments, or NULL if stdin couldn't be read. An error will have been displayed
+ */
+char **readArgumentLines(char **text, int *count) {
+    size_t length = 0;
+    size_t capacity = PARALLEL_OUTPUT;
+    ssize_t got;
+
+    *text = malloc(capacity);
+
+    while ((got = read(STDIN_FILENO, *text + length, capacity - length - 1)) != 0) {
+        if (got < 0 && errno == EINTR) { continue; }
+
+        if (got < 0) {
+            red("[Error] ");
+            printf("Unable to read arguments: %s\n", strerror(errno));
+            free(*text);
+            return NULL;
+        }
+
+        length += got;
+        if (length + 1 == capacity) {
+            capacity *= 2;
+            *text = realloc(*text, capacity);
+        }
+    }
+
+    (*text)[length] = '\0';
+
+    int lines = 1;
+    for (size_t i = 0; i < length; ++i) {
+        if ((*text)[i] == '\n') { lines++; }
+    }
+
+    char **args = malloc(lines * sizeof(char *));
+    *count = 0;
+
+    for (char *line = strtok(*text, "\n"); line != NULL; line = strtok(NULL, "\n")) { args[(*count)++] = line; }
+
+    return args;
+}
+
+
+/**
+ * Build the arguments of the next command, which is the command given to parallel with a batch of arguments put in
+ * place of each {}, or added to the end if there is no {}. Arguments are added until there are perBatch of them, or the
+ * next one would not fit in space. At least one is always added, if it is too long exec will say so
+ *
+ * @param command The command given to parallel, along with any arguments of its own
+ * @param nCommand Number of words in command
+ * @param args Arguments left to be run
+ * @param nArgs Number of arguments left
+ * @param perBatch Most arguments to add
+ * @param space Bytes available for arguments, see argumentSpace()
+ * @param used Set to the number of arguments added
+ * @return NULL terminated arguments for the command, to be freed once it has been launched
+ */
+char **buildBatch(char *command[], int nCommand, char *args[], int nArgs, int perBatch, long space, int *used) {
+    int placeholders = 0;
+    long size = 0;
+
+    for (int i = 0; i < nCommand; ++i) {
+        if (strcmp(command[i], "{}") == 0) { placeholders++; }
+        else { size += strlen(command[i]) + 1 + sizeof(char *); }
+    }
+
+    int copies = (placeholders > 0) ? placeholders : 1; // Times each argument appears in the command
+    int taken = 0;
+
+    while (taken < nArgs && taken < perBatch) {
+        long needed = (strlen(args[taken]) + 1 + sizeof(char *)) * copies;
+        if (taken > 0 && size + needed > space) { break; }
+
+        size += needed;
+        taken++;
+    }
+
+    char **argv = malloc((nCommand + taken * copies + 1) * sizeof(char *));
+    int w = 0;
+
+    for (int i = 0; i < nCommand; ++i) {
+        if (strcmp(command[i], "{}") == 0) {
+            for (int a = 0; a < taken; ++a) { argv[w++] = args[a]; }
+        } else {
+            argv[w++] = command[i];
+        }
+    }
+
+    if (placeholders == 0) {
+        for (int a = 0; a < taken; ++a) { argv[w++] = args[a]; }
+    }
+
+    argv[w] = NULL;
+    *used = taken;
+    return argv;
+}
+
+
+/**
+ * Launch a command for a free worker, with its output and errors going into pipes for the worker to collect
+ * Every worker's command joins one process group, which is given the terminal, so that Ctrl+C reaches all of them
+ * SIGCHLD must be blocked
+ *
+ * @param worker The worker to run the command
+ * @param path Path to the executable, as found by hashLookup
+ * @param argv NULL terminated arguments of the command
+ * @param input File descriptor to use as the command's stdin
+ * @param group Process group for the command to join, or 0 to start a new one. Set to the group it is in
+ * @return 0 on success, 1 if it could not be launched. An error will have been displayed
+ */
+int startWorker(Worker *worker, char *path, char **argv, int input, pid_t *group) {
+    int fds[4] = { -1, -1, -1, -1 }; // Pipe for the command's output, then one for its errors
+
+    if (pipe2(fds, O_CLOEXEC) < 0 || pipe2(fds + 2, O_CLOEXEC) < 0) {
+        red("[Error] ");
+        printf("Unable to create pipe: %s\n", strerror(errno));
+        for (int i = 0; i < 4; ++i) { if (fds[i] >= 0) { close(fds[i]); } }
+        return 1;
+    }
+
+    // A job with a single stage, so that the command shows up the same way as any other
+    Pipeline pipeline;
+    pipeline.nStages = 1;
+    pipeline.background = 0;
+    pipeline.stages[0].argv = argv;
+    pipeline.stages[0].nRedirects = 0;
+
+    Job *job = newJob(&pipeline, 0);
+    if (job == NULL) {
+        for (int i = 0; i < 4; ++i) { close(fds[i]); }
+        return 1;
+    }
+
+    LaunchIO io = { input, fds[1], fds[3], *group, NULL, 0, *group == 0 };
+
+    long long started = nanoseconds();
+    pid_t pid = launchProcess(path, argv, &io);
+    stopTimer(TIMER_LAUNCH, started);
+    close(fds[1]);
+    close(fds[3]);
+
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[2]);
+        job->id = 0;
+        return 1;
+    }
+
+    addToJob(job, pid);
+    if (*group == 0) { *group = pid; }
+    job->pgid = *group;
+
+    worker->job = job;
+    worker->output.fd = fds[0];
+    worker->output.length = 0;
+    worker->errors.fd = fds[2];
+    worker->errors.length = 0;
+    return 0;
+}
+
+
+/**
+ * Read whatever a worker's command has written to one of its pipes
+ * @param capture The pipe, and what has been read from it so far
+ */
+void collectOutput(Capture *capture) {
+    if (capture->length == capture->capacity) {
+        capture->capacity = (capture->capacity == 0) ? PARALLEL_OUTPUT : capture->capacity * 2;
+        capture->buffer = realloc(capture->buffer, capture->capacity);
+    }
+
+    ssize_t got = read(capture->fd, capture->buffer + capture->length, capture->capacity - capture->length);
+
+    if (got > 0) {
+        capture->length += got;
+    } else if (got == 0 || errno != EINTR) { // Everything has been read
+        close(capture->fd);
+        capture->fd = -1;
+    }
+}
+
+
+/**
+ * Print the output of a worker's command, which has finished, to stdout and its errors to stderr, then free the
+ * worker for another command
+ * @param worker The worker
+ * @param interrupted Set to 1 if the command was killed by Ctrl+C
+ * @return The exit status of the command
+ */
+int finishWorker(Worker *worker, int *interrupted) {
+    Job *job = worker->job;
+    int last = job->statuses[job->nProcs - 1];
+    int status = jobStatus(job);
+
+    fwrite(worker->output.buffer, 1, worker->output.length, stdout);
+    fflush(stdout);
+    fwrite(worker->errors.buffer, 1, worker->errors.length, stderr);
+
+    if (WIFSIGNALED(last) && WTERMSIG(last) == SIGINT) { *interrupted = 1; }
+
+    job->id = 0; // Free the slot
+    worker->job = NULL;
+    return status;
+}
+
+
+/**
+ * parallel [-j workers] [-n args] <command> [::: <arg>...]
+ * Run the command for each batch of arguments, with up to workers commands running at once. By default there is a
+ * worker for each CPU, and each batch has as many arguments as it takes to share them evenly between the workers,
+ * limited by ARG_MAX. Without :::, arguments are read from stdin, one per line
+ *
+ * @param n Number of tokens
+ * @param tokens The tokens, starting with "parallel"
+ * @return 0 if every command succeeded, otherwise the number of commands that failed, up to 101 for more than 100
+ *         as GNU parallel does. 130 if interrupted by Ctrl+C, or 2 if parallel was called wrongly
+ */
+int runParallel(int n, char *tokens[]) {
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    int perBatch = 0; // 0 to share the arguments evenly between the workers
+    int i = 1;
+
+    // Options
+    for (; i < n && tokens[i][0] == '-'; i += 2) {
+        int isWorkers = strcmp(tokens[i], "-j") == 0;
+
+        if ((!isWorkers && strcmp(tokens[i], "-n") != 0) || i + 1 >= n) {
+            red("[Error] "); printf("Unknown option \"%s\". Try calling \"parallel [-j workers] [-n args] <command> ::: <arg>...\"\n", tokens[i]);
+            return 2;
+        }
+
+        int count = parseCount(tokens[i + 1], tokens[i]);
+        if (count < 0) { return 2; }
+
+        if (isWorkers) { workers = count; }
+        else { perBatch = count; }
+    }
+
+    char **command = &tokens[i]; // The command to run, followed by its own arguments
+    int nCommand = 0;
+    while (i + nCommand < n && strcmp(tokens[i + nCommand], ":::") != 0) { nCommand++; }
+
+    if (nCommand == 0) {
+        red("[Error] "); printf("Nothing to run. Try calling \"parallel [-j workers] [-n args] <command> ::: <arg>...\"\n");
+        return 2;
+    }
+
+    // Builtins such as echo are run as the system command of the same name, if there is one
+    char *path = hashLookup(command[0]);
+    if (path == NULL) {
+        red("[Error] ");
+        if (findBuiltin(command[0]) != NULL) { printf("\"%s\" is a builtin, parallel can only run system commands\n", command[0]); }
+        else { printf("That command was not found: %s\n", command[0]); }
+        return 127;
+    }
+
+    // Arguments after :::, or else from stdin
+    char *text = NULL;
+    char **args;
+    int nArgs;
+
+    if (i + nCommand < n) {
+        args = &tokens[i + nCommand + 1];
+        nArgs = n - (i + nCommand + 1);
+    } else if ((args = readArgumentLines(&text, &nArgs)) == NULL) {
+        return 1;
+    }
+
+    // Each worker needs a slot in the job table
+    int freeJobs = MAX_JOBS - countJobs();
+    if (workers > freeJobs) { workers = freeJobs; }
+    if (workers > nArgs) { workers = nArgs; }
+    if (perBatch == 0 && workers > 0) { perBatch = (nArgs + workers - 1) / workers; }
+
+    Worker *pool = calloc(workers, sizeof(Worker));
+    struct pollfd *polled = malloc(2 * workers * sizeof(struct pollfd)); // Each worker's output and errors
+    Capture **polledCapture = malloc(2 * workers * sizeof(Capture *)); // Pipe each entry of polled belongs to
+    long space = argumentSpace();
+    int input = open("/dev/null", O_RDONLY | O_CLOEXEC); // Commands can't all read from the terminal at once
+    int next = 0; // Index of the next argument to run
+    int failed = 0;
+    int interrupted = 0;
+    pid_t group = 0;
+
+    if (nArgs > 0 && workers == 0) {
+        red("[Error] ");
+        printf("Too many jobs, the maximum is %i. Please wait for some to finish\n", MAX_JOBS);
+        failed = 1;
+    }
+
+    sigset_t waiting; // Signal mask to use while waiting, with SIGCHLD unblocked
+    blockChildSignal(1);
+    sigprocmask(SIG_SETMASK, NULL, &waiting);
+    sigdelset(&waiting, SIGCHLD);
+
+    for (;;) {
+        int busy = 0;
+        int running = 0; // Processes that haven't been reaped, which keep the process group alive
+
+        for (int w = 0; w < workers; ++w) {
+            if (pool[w].job != NULL) { running += pool[w].job->remaining; }
+        }
+        if (running == 0) { group = 0; }
+
+        // Give every free worker a batch of arguments
+        for (int w = 0; w < workers; ++w) {
+            if (pool[w].job == NULL && next < nArgs && !interrupted) {
+                int used;
+                char **argv = buildBatch(command, nCommand, &args[next], nArgs - next, perBatch, space, &used);
+
+                next += used;
+                if (startWorker(&pool[w], path, argv, input, &group) != 0) { failed++; }
+                free(argv);
+            }
+
+            if (pool[w].job != NULL) { busy++; }
+        }
+
+        if (busy == 0) { break; }
+
+        // Wait for output, or for a command to finish
+        int nPolled = 0;
+
+        for (int w = 0; w < workers; ++w) {
+            if (pool[w].job == NULL) { continue; }
+            if (pool[w].job->stopped > 0) { kill(-pool[w].job->pgid, SIGCONT); } // parallel itself can't be stopped
+
+            Capture *captures[2] = { &pool[w].output, &pool[w].errors };
+
+            for (int c = 0; c < 2; ++c) {
+                if (captures[c]->fd >= 0) {
+                    polled[nPolled].fd = captures[c]->fd;
+                    polled[nPolled].events = POLLIN;
+                    polledCapture[nPolled++] = captures[c];
+                }
+            }
+        }
+
+        long long started = nanoseconds();
+        int ready = ppoll(polled, nPolled, NULL, &waiting);
+        stopTimer(TIMER_WAIT, started);
+
+        for (int p = 0; ready > 0 && p < nPolled; ++p) {
+            if (polled[p].revents != 0) { collectOutput(polledCapture[p]); }
+        }
+
+        // Print the output of every command that has finished and has closed its output and errors
+        for (int w = 0; w < workers; ++w) {
+            if (pool[w].job != NULL && pool[w].job->remaining == 0 && pool[w].output.fd < 0 && pool[w].errors.fd < 0) {
+                if (finishWorker(&pool[w], &interrupted) != 0) { failed++; }
+            }
+        }
+    }
+
+    if (shellTerminal >= 0) { tcsetpgrp(shellTerminal, getpgrp()); } // Take back the terminal
+    blockChildSignal(0);
+
+    for (int w = 0; w < workers; ++w) {
+        free(pool[w].output.buffer);
+        free(pool[w].errors.buffer);
+    }
+    free(pool);
+    free(polled);
+    free(polledCapture);
+    if (input >= 0) { close(input); }
+
+    if (text != NULL) {
+        free(text);
+        free(args);
+    }
+
+    if (interrupted) { return 128 + SIGINT; }
+    return (failed > 100) ? 101 : failed;
+}
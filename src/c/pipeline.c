@@ -0,0 +1,465 @@
+// Here we handle pipelines, where the output of each command is fed into the input of the next, e.g. "ls | wc -l"
+// and redirections, where a command reads from or writes to a file, e.g. "ls > files.txt"
+// Operators are recognised by the lexer, then the tokens are split up into stages and every stage is launched at once
+// A line can hold a list of pipelines joined by ;, &, && or ||, e.g. "make && ./run", which are run one after another
+
+char *OPERATORS[] = { "|", "<", ">", ">>", "2>", "2>>", "2>&1", "&", "&&", "||", ";" }; // Text of each operator, in the same order as Operator (Excluding OP_NONE)
+int pipeSize = 0; // Capacity in bytes of pipes between stages, 0 to use the system default
+int lastFailureExempt = 0; // 1 if lastStatus is from a command followed by && or ||, so -e doesn't stop at it
+
+
+/**
+ * Operators are represented in the tokens array by pointers into OPERATORS, so a quoted "|" remains a regular word
+ * @param token The token to check
+ * @return The operator this token represents, or OP_NONE
+ */
+Operator operatorType(char *token) {
+    for (int i = 0; i < (int) (sizeof(OPERATORS) / sizeof(OPERATORS[0])); ++i) {
+        if (token == OPERATORS[i]) { return i + 1; }
+    }
+
+    return OP_NONE;
+}
+
+
+/**
+ * Check if an operator begins at the given position in the input, preferring the longest match
+ * Operators beginning with a file descriptor number, such as 2>, must be at the start of a word so that "ls file2>out"
+ * writes ls's stdout to "out"
+ *
+ * @param position The position in the input to check
+ * @param wordStart 1 if position is at the start of a word
+ * @param length Set to the number of characters in the matched operator
+ * @return The operator found, or OP_NONE
+ */
+Operator matchOperator(char *position, int wordStart, int *length) {
+    Operator found = OP_NONE;
+    *length = 0;
+
+    for (int i = 0; i < (int) (sizeof(OPERATORS) / sizeof(OPERATORS[0])); ++i) {
+        int l = strlen(OPERATORS[i]);
+        if (!wordStart && isdigit(OPERATORS[i][0])) { continue; }
+        if (l > *length && strncmp(position, OPERATORS[i], l) == 0) {
+            found = i + 1;
+            *length = l;
+        }
+    }
+
+    return found;
+}
+
+
+/**
+ * Return if an operator is a redirection, rather than something that joins commands together
+ * @param op The operator to check
+ * @return 1 if this is a redirection
+ */
+int isRedirect(Operator op) {
+    return op >= OP_IN && op <= OP_ERR_TO_OUT;
+}
+
+
+/**
+ * Return if an operator ends a command in a list, rather than being part of the command
+ * @param op The operator to check
+ * @return 1 for ;, &, && and ||
+ */
+int isListOperator(Operator op) {
+    return op >= OP_BACKGROUND && op <= OP_SEMICOLON;
+}
+
+
+/**
+ * Check that a pipeline can be built, without changing the tokens, so that a whole list can be checked before any of
+ * it runs. Every stage must have a command, every redirection other than 2>&1 must have a file, and & may only come
+ * at the end
+ *
+ * @param tokens The tokens of one pipeline
+ * @param n Number of tokens
+ * @return 0 if the pipeline is valid, 1 if not. An error will have been displayed
+ */
+int checkPipeline(char *tokens[], int n) {
+    int words = 0; // Number of arguments in the current stage
+    int redirects = 0; // Number of redirections in the current stage
+    int stages = 0; // Number of stages before the current one
+
+    // A trailing & runs the whole pipeline in the background
+    if (n > 0 && operatorType(tokens[n - 1]) == OP_BACKGROUND) { n--; }
+
+    for (int i = 0; i <= n; ++i) {
+        Operator op = (i < n) ? operatorType(tokens[i]) : OP_NONE;
+
+        if (op == OP_BACKGROUND) {
+            red("[Error] ");
+            printf("\"&\" can only be used at the end of a command. Try calling \"<command> &\"\n");
+            return 1;
+        }
+
+        // Redirection, which must be followed by its file, e.g. > out.txt
+        if (isRedirect(op)) {
+            if (op != OP_ERR_TO_OUT && (i + 1 >= n || operatorType(tokens[++i]) != OP_NONE)) {
+                red("[Error] ");
+                printf("\"%s\" must be followed by a file name\n", OPERATORS[op - 1]);
+                return 1;
+            }
+
+            if (++redirects > MAX_REDIRECTS) {
+                red("[Error] ");
+                printf("A command can have at most %i redirections\n", MAX_REDIRECTS);
+                return 1;
+            }
+            continue;
+        }
+
+        // Argument for the current stage
+        if (i < n && op != OP_PIPE) {
+            words++;
+            continue;
+        }
+
+        // End of a stage, either a | or the end of the command
+        if (words == 0) {
+            red("[Error] ");
+            if (op == OP_PIPE || stages > 0) {
+                printf("Each side of a \"|\" must have a command. Try calling \"<command> | <command>\"\n");
+            } else {
+                printf("A redirection must follow a command. Try calling \"<command> > <file>\"\n");
+            }
+            return 1;
+        }
+
+        if (++stages >= MAX_STAGES && op == OP_PIPE) {
+            red("[Error] ");
+            printf("A pipeline can have at most %i commands\n", MAX_STAGES);
+            return 1;
+        }
+
+        words = 0;
+        redirects = 0;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Split tokens into the stages of a pipeline, taking redirections and their targets out of each stage's arguments
+ * Each | is replaced with NULL, and the remaining words are moved down over any redirections, so that each stage's
+ * arguments can point straight into the tokens array
+ *
+ * @param tokens The tokens entered by the user, NULL terminated
+ * @param n Number of tokens
+ * @param pipeline The pipeline to fill in
+ * @return 0 on success, 1 if the pipeline is not valid, see checkPipeline()
+ */
+int buildPipeline(char *tokens[], int n, Pipeline *pipeline) {
+    if (checkPipeline(tokens, n) != 0) { return 1; }
+
+    int start = 0; // Index the current stage's arguments begin at
+    int w = 0; // Index the next argument should be moved to
+    pipeline->nStages = 0;
+    pipeline->stages[0].nRedirects = 0;
+    pipeline->background = 0;
+
+    // A trailing & runs the whole pipeline in the background
+    if (n > 0 && operatorType(tokens[n - 1]) == OP_BACKGROUND) {
+        pipeline->background = 1;
+        tokens[--n] = NULL;
+    }
+
+    for (int i = 0; i <= n; ++i) {
+        Operator op = (i < n) ? operatorType(tokens[i]) : OP_NONE;
+        Stage *stage = &pipeline->stages[pipeline->nStages];
+
+        // Redirection, record it along with its file, e.g. > out.txt
+        if (isRedirect(op)) {
+            stage->redirects[stage->nRedirects].type = op;
+            stage->redirects[stage->nRedirects++].target = (op == OP_ERR_TO_OUT) ? NULL : tokens[++i];
+            continue;
+        }
+
+        // Argument for the current stage
+        if (i < n && op != OP_PIPE) {
+            tokens[w++] = tokens[i];
+            continue;
+        }
+
+        // End of a stage, either a | or the end of the command
+        stage->argv = &tokens[start];
+        stage->argc = w - start;
+        tokens[w++] = NULL;
+        start = w;
+
+        if (++pipeline->nStages < MAX_STAGES) {
+            pipeline->stages[pipeline->nStages].nRedirects = 0;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Builtins run inside the shell, so to redirect their input or output we redirect the shell's own file descriptors,
+ * keeping a copy of the originals so they can be put back afterwards by restoreShell()
+ *
+ * @param stage The command being run, along with its redirections
+ * @param saved Filled with copies of the shell's stdin, stdout and stderr
+ * @return 0 on success, 1 if a redirection failed. The shell will already have been restored
+ */
+int redirectShell(Stage *stage, int saved[3]) {
+    fflush(stdout); // Anything already printed belongs to the original stdout
+
+    for (int fd = 0; fd < 3; ++fd) {
+        saved[fd] = (stage->nRedirects > 0) ? fcntl(fd, F_DUPFD_CLOEXEC, 10) : -1;
+    }
+
+    int failed = applyRedirects(stage->redirects, stage->nRedirects);
+
+    if (failed >= 0) {
+        int error = errno;
+        restoreShell(saved);
+        red("[Error] ");
+        printf("%s: %s\n", stage->redirects[failed].target, strerror(error));
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Put back the file descriptors saved by redirectShell()
+ * @param saved Copies of the shell's stdin, stdout and stderr
+ */
+void restoreShell(int saved[3]) {
+    fflush(stdout); // Output from the builtin belongs to the redirected stdout
+
+    for (int fd = 0; fd < 3; ++fd) {
+        if (saved[fd] >= 0) {
+            dup2(saved[fd], fd);
+            close(saved[fd]);
+        }
+    }
+}
+
+
+/**
+ * Check a whole list before any of it runs, so that a mistake part way through doesn't leave the commands before it
+ * run. Every operator in the list must have a command before it, && and || must have a command after them, and each
+ * command must be a valid pipeline, see checkPipeline()
+ *
+ * @param tokens The tokens entered by the user
+ * @param n Number of tokens
+ * @return 0 if the list is valid, otherwise 2. An error will have been displayed
+ */
+int checkList(char *tokens[], int n) {
+    int start = 0; // Index the current command begins at
+
+    for (int i = 0; i <= n; ++i) {
+        Operator op = (i < n) ? operatorType(tokens[i]) : OP_NONE;
+        if (i < n && !isListOperator(op)) { continue; }
+        if (i == n && start == n) { break; } // Nothing after a trailing ; or &
+
+        int last = (i == n - 1);
+
+        if (i == start || (last && (op == OP_AND || op == OP_OR))) {
+            red("[Error] ");
+            printf("\"%s\" must come between two commands. Try calling \"<command> %s <command>\"\n", OPERATORS[op - 1],
+                   OPERATORS[op - 1]);
+            return 2;
+        }
+
+        // & stays with its command, so that it is run in the background
+        int end = (op == OP_BACKGROUND) ? i + 1 : i;
+        if (checkPipeline(&tokens[start], end - start) != 0) { return 2; }
+
+        start = i + 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Run a list of commands joined by ;, &, && or ||, e.g. "make && ./run || echo failed"
+ * Each command runs after the one before it has finished, except after & which leaves it running in the background.
+ * The command after && only runs if the last command succeeded, and the command after || only runs if it failed.
+ * Neither takes precedence, so a list is worked through from left to right as in other shells.
+ * lastStatus is updated as each command finishes, so that $? and exit see it. With -e the list stops at a failure,
+ * unless the command was followed by && or ||, in which case lastFailureExempt is set so the shell carries on too.
+ *
+ * @param tokens The tokens entered by the user, NULL terminated
+ * @param n Number of tokens
+ * @return The exit status of the last command run, or 2 if the list is not valid
+ */
+int runList(char *tokens[], int n) {
+    lastFailureExempt = 0;
+    if (checkList(tokens, n) != 0) { return 2; }
+
+    int status = lastStatus;
+    Operator joined = OP_SEMICOLON; // Operator between the current command and the one before it
+    int start = 0; // Index the current command begins at
+
+    for (int i = 0; i <= n && start < n; ++i) {
+        Operator op = (i < n) ? operatorType(tokens[i]) : OP_NONE;
+        if (i < n && !isListOperator(op)) { continue; }
+
+        int end = (op == OP_BACKGROUND) ? i + 1 : i; // & stays with its command, so that it is run in the background
+        int run = (joined == OP_AND) ? status == 0 : (joined == OP_OR) ? status != 0 : 1;
+
+        if (run) {
+            char *expanded = expandStatus(&tokens[start], end - start, status);
+
+            if (i < n && op != OP_BACKGROUND) { tokens[i] = NULL; }
+
+            Glob glob;
+            int count = expandGlobs(&tokens[start], end - start, &glob);
+            status = (count < 0) ? 1 : processCommand(count, glob.tokens);
+            lastStatus = status;
+            lastFailureExempt = (op == OP_AND || op == OP_OR);
+            freeGlob(&glob);
+            free(expanded);
+
+            if (stopOnError && status != 0 && op != OP_AND && op != OP_OR) { break; }
+        }
+
+        joined = op;
+        start = i + 1;
+    }
+
+    return status;
+}
+
+
+/**
+ * Run a pipeline, connecting the stdout of each stage to the stdin of the next
+ * Every command is found on the PATH before anything is started, so a mistyped command doesn't leave half a pipeline
+ * running. All stages are placed in one process group as a single job, and are waited for together unless the
+ * pipeline is to be run in the background. A builtin in a pipeline of several stages, e.g. "history | grep make", or
+ * on its own in the foreground, e.g. "sleep 10", is run in a child process of its own, see launchBuiltin()
+ *
+ * @param pipeline The pipeline to run
+ * @param external 1 if the first stage must be a system command even if there is a builtin of the same name
+ * @return The exit status of the last stage, or 0 if the pipeline was started in the background
+ */
+int runPipeline(Pipeline *pipeline, int external) {
+    char *paths[MAX_STAGES]; // Executable for each stage
+    Builtin *builtins[MAX_STAGES]; // Builtin for each stage, or NULL to run a system command
+
+    // Find every command first. A pipeline of one stage in the background only gets here if it is to be run as a
+    // system command, see processCommand()
+    for (int i = 0; i < pipeline->nStages; ++i) {
+        int builtin = (pipeline->nStages > 1 || !pipeline->background) && !(i == 0 && external);
+        builtins[i] = builtin ? findBuiltin(pipeline->stages[i].argv[0]) : NULL;
+        paths[i] = (builtins[i] == NULL) ? hashLookup(pipeline->stages[i].argv[0]) : NULL;
+
+        if (builtins[i] == NULL && paths[i] == NULL) {
+            red("[Error] ");
+            printf("That command was not found: %s\n", pipeline->stages[i].argv[0]);
+            return 127;
+        }
+    }
+
+    // Hold off SIGCHLD until every process has been added to the job, otherwise a process could finish before the
+    // job knows about it
+    blockChildSignal(1);
+
+    Job *job = newJob(pipeline, pipeline->background);
+    if (job == NULL) {
+        blockChildSignal(0);
+        return 1;
+    }
+
+    // The first stage reads from the shell's stdin and starts a new process group
+    LaunchIO io = { -1, -1, -1, 0, NULL, 0, !pipeline->background };
+    int failure = 126; // Status if a stage can't be started, 1 if it was a redirection that failed
+
+    for (int i = 0; i < pipeline->nStages; ++i) {
+        int fds[2] = { -1, -1 };
+
+        // Every stage except the last writes into a pipe. Close on exec, so only the stages using it keep it open
+        if (i < pipeline->nStages - 1) {
+            if (pipe2(fds, O_CLOEXEC) < 0) {
+                red("[Error] ");
+                printf("Unable to create pipe: %s\n", strerror(errno));
+                break;
+            }
+
+            if (pipeSize > 0 && fcntl(fds[1], F_SETPIPE_SZ, pipeSize) < 0 && i == 0) {
+                yellow("[Warning] ");
+                printf("Unable to set pipe size to %i bytes: %s\n", pipeSize, strerror(errno));
+            }
+        }
+
+        io.out = fds[1];
+        io.redirects = pipeline->stages[i].redirects;
+        io.nRedirects = pipeline->stages[i].nRedirects;
+        long long started = nanoseconds();
+        pid_t pid = (builtins[i] != NULL) ? launchBuiltin(builtins[i], pipeline->stages[i].argv, &io)
+                                          : launchProcess(paths[i], pipeline->stages[i].argv, &io);
+        stopTimer(TIMER_LAUNCH, started);
+
+        // The shell's copies of the pipe are no longer needed, the next stage reads from this one's pipe
+        if (io.in >= 0) { close(io.in); }
+        if (io.out >= 0) { close(io.out); }
+        io.in = fds[0];
+
+        if (pid < 0) {
+            if (pid == -2) { failure = 1; }
+            break;
+        }
+
+        addToJob(job, pid);
+        io.pgid = job->pgid; // Later stages join the first stage's process group
+    }
+
+    if (io.in >= 0) { close(io.in); }
+
+    int status;
+
+    if (job->nProcs == 0) { // Nothing could be started
+        job->id = 0;
+        status = failure;
+    } else if (pipeline->background) {
+        printf("[%i] %i\n", job->id, job->pgid);
+        status = 0;
+    } else {
+        long long started = nanoseconds();
+        status = waitForJob(job);
+        stopTimer(TIMER_WAIT, started);
+        if (job->nProcs < pipeline->nStages) { status = failure; }
+    }
+
+    blockChildSignal(0);
+    return status;
+}
+
+
+/**
+ * Set the capacity of pipes between stages
+ * @param size Number of bytes, or 0 to use the system default. The kernel will round this up to a whole number of pages
+ * @return 0 on success, 1 if size is not a number
+ */
+int setPipeSize(char *size) {
+    char *end;
+    long bytes = strtol(size, &end, 10);
+
+    if (*end != 0 || bytes < 0 || bytes > INT_MAX) {
+        red("[Error] ");
+        printf("\"%s\" is not a valid pipe size. Please enter a number of bytes, or 0 for the default\n", size);
+        return 1;
+    }
+
+    pipeSize = bytes;
+    displayPipeSize();
+    return 0;
+}
+
+
+/* Display the capacity of pipes between stages */
+void displayPipeSize() {
+    blue("[Info] ");
+    if (pipeSize == 0) { printf("Pipes use the default capacity\n"); }
+    else { printf("Pipes have a capacity of %i bytes\n", pipeSize); }
+}
\ No newline at end of file
@@ -0,0 +1,406 @@
+// Here we build the prompt out of segments, each showing one piece of information about the shell
+// PROMPT_SEGMENTS chooses which segments are shown and in what order, e.g. PROMPT_SEGMENTS="git cwd", otherwise
+// PROMPT_DEFAULT is used. Segments with nothing to show, e.g. git outside of a repository, are left out.
+//
+//      cwd         The current working directory, ~/ in the users' home directory
+//      git         The git branch checked out, followed by * if any tracked files have been changed
+//      status      The exit status of the last command, if it failed
+//      duration    How long the last command took, if it took longer than PROMPT_DURATION_MS
+//      jobs        The number of jobs, if there are any
+//
+// Working out the git status means running git, which can take a long time in a large repository, so it is done by a
+// thread in the background. Statuses are cached for each directory, and the prompt is shown straight away with
+// whatever is in the cache, even if it is out of date. When the thread has finished it writes to a pipe, which wakes
+// the line editor up to redraw the prompt, see segmentsFd(). Statuses go out of date after each command is run, since
+// the command may have changed the repository, see segmentsStale()
+
+Segment *promptSegments[PROMPT_MAX_SEGMENTS]; // Segments shown, in order
+int nSegments = -1; // Number of segments shown, -1 until PROMPT_SEGMENTS has been read
+PromptText promptText = { 0 }; // The prompt as last built
+char *cwdText = NULL; // Text of the cwd segment, NULL if it needs to be worked out again, see promptChanged()
+
+GitStatus gitCache[GIT_CACHE_SIZE]; // Git status of the directories most recently shown in the prompt
+unsigned long gitClock = 0; // Increases each time a git status is used, to find the least recently used
+int promptGeneration = 0; // Increases each time a command is run, a status worked out before then is out of date
+pthread_mutex_t gitLock = PTHREAD_MUTEX_INITIALIZER; // Protects gitCache and promptGeneration
+pthread_cond_t gitRequest = PTHREAD_COND_INITIALIZER; // Signalled when a git status is wanted
+pthread_t gitThread; // Thread working out git statuses, started the first time one is wanted
+int gitPipe[2] = { -1, -1 }; // Written to by the thread each time it has worked out a git status
+
+
+/* Add text to the prompt, in colour if colour is being used */
+void addText(PromptText *prompt, char *code, char *text) {
+    size_t needed = prompt->length + strlen(code) + strlen(text) + strlen(COLOUR_RESET) + 1;
+
+    if (needed > prompt->capacity) {
+        prompt->capacity = needed * 2;
+        prompt->text = realloc(prompt->text, prompt->capacity);
+    }
+
+    int coloured = useColour && code[0] != '\0';
+    prompt->length += sprintf(prompt->text + prompt->length, "%s%s%s", coloured ? code : "", text, coloured ? COLOUR_RESET : "");
+    prompt->columns += textColumns(text, strlen(text));
+}
+
+
+/* Add a segment to the prompt, separated from the one before by a space */
+void addSegment(PromptText *prompt, char *code, char *text) {
+    if (prompt->length > 0) { addText(prompt, "", " "); }
+    addText(prompt, code, text);
+}
+
+
+/* cwd - The current working directory, which only changes when the user changes directory */
+void renderCwd(PromptText *prompt) {
+    if (cwdText == NULL) {
+        // We are in users' home directory
+        if (getHome() != NULL && strcmp(getCwd(), getHome()) == 0) { cwdText = strdup("~/"); }
+        else { cwdText = strdup(getCwd()); }
+    }
+
+    addSegment(prompt, COLOUR_GREEN, cwdText);
+}
+
+
+/* status - The exit status of the last command, if it failed */
+void renderStatus(PromptText *prompt) {
+    if (lastStatus == 0) { return; }
+
+    char text[32];
+    sprintf(text, "[%i]", lastStatus);
+    addSegment(prompt, COLOUR_RED, text);
+}
+
+
+/* duration - How long the last command took, if it was longer than PROMPT_DURATION_MS */
+void renderDuration(PromptText *prompt) {
+    if (lastDuration < PROMPT_DURATION_MS) { return; }
+
+    char text[32];
+    if (lastDuration < 60000) { sprintf(text, "%.1fs", lastDuration / 1000.0); }
+    else { sprintf(text, "%lim%02lis", lastDuration / 60000, (lastDuration / 1000) % 60); }
+
+    addSegment(prompt, COLOUR_BLUE, text);
+}
+
+
+/* jobs - The number of jobs, if there are any */
+void renderJobs(PromptText *prompt) {
+    int count = countJobs();
+    if (count == 0) { return; }
+
+    char text[32];
+    sprintf(text, "[%i job%s]", count, count == 1 ? "" : "s");
+    addSegment(prompt, COLOUR_BLUE, text);
+}
+
+
+/**
+ * Find the git directory of the repository a directory is in, looking in each parent directory in turn
+ * @param directory An absolute path
+ * @return The git directory, which must be freed, or NULL if the directory isn't in a git repository
+ */
+char *findGitDir(char *directory) {
+    size_t length = strlen(directory); // Length of the directory being looked in
+    char *path = malloc(length + strlen("/.git") + 1);
+    strcpy(path, directory);
+
+    for (;;) {
+        int root = (length == 1); // The root directory, "/"
+        strcpy(path + length, root ? ".git" : "/.git");
+
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) { return path; }
+
+            // Worktrees and submodules have a .git file instead, holding "gitdir: <path>"
+            char line[MAX_PATH];
+            FILE *file = fopen(path, "re");
+            int found = file != NULL && fgets(line, sizeof(line), file) != NULL && strncmp(line, "gitdir: ", 8) == 0;
+            if (file != NULL) { fclose(file); }
+
+            if (found) {
+                line[strcspn(line, "\n")] = '\0';
+                path[length] = '\0';
+
+                char *gitDir = malloc(length + strlen(line) + 2);
+                if (line[8] == '/') { strcpy(gitDir, line + 8); }
+                else { sprintf(gitDir, "%s/%s", path, line + 8); } // Relative to the directory holding .git
+
+                free(path);
+                return gitDir;
+            }
+        }
+
+        // Move up to the parent directory, stopping once the root has been checked
+        path[length] = '\0';
+        char *slash = strrchr(path, '/');
+        if (root || slash == NULL) { break; }
+
+        length = (slash == path) ? 1 : (size_t) (slash - path);
+        path[length] = '\0';
+    }
+
+    free(path);
+    return NULL;
+}
+
+
+/**
+ * Work out the branch checked out in a directory, and whether any tracked files have been changed
+ * Run by the git status thread
+ *
+ * @param directory The directory
+ * @param dirty Set to 1 if any tracked files have been changed
+ * @return The branch, or the start of the commit if no branch is checked out. NULL if not in a git repository
+ */
+char *gitStatus(char *directory, int *dirty) {
+    char *gitDir = findGitDir(directory);
+    if (gitDir == NULL) { return NULL; }
+
+    // HEAD holds "ref: refs/heads/<branch>", or a commit if no branch is checked out
+    char *headPath = malloc(strlen(gitDir) + strlen("/HEAD") + 1);
+    sprintf(headPath, "%s/HEAD", gitDir);
+
+    char head[256] = "";
+    int fd = open(headPath, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ssize_t count = read(fd, head, sizeof(head) - 1);
+        head[count > 0 ? count : 0] = '\0';
+        close(fd);
+    }
+
+    free(headPath);
+    free(gitDir);
+
+    head[strcspn(head, "\n")] = '\0';
+    char *branch = (strncmp(head, "ref: refs/heads/", 16) == 0) ? strdup(head + 16) : strndup(head, 7);
+
+    // Any output from git status means a tracked file has changed. Optional locks are skipped, so that this never
+    // gets in the way of git commands the user runs
+    char *argv[] = { "git", "--no-optional-locks", "-C", directory, "status", "--porcelain", "--untracked-files=no", NULL };
+    int output[2];
+    *dirty = 0;
+
+    if (pipe2(output, O_CLOEXEC) != 0) { return branch; }
+
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    sigset_t none, all;
+    sigemptyset(&none);
+    sigfillset(&all);
+
+    // This thread blocks every signal, and the shell ignores some, git should have neither
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setsigdefault(&attr, &all);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid;
+    int spawned = posix_spawnp(&pid, "git", &actions, &attr, argv, environ) == 0;
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(output[1]);
+
+    if (spawned) {
+        char buffer[4096];
+        ssize_t count;
+
+        while ((count = read(output[0], buffer, sizeof(buffer))) != 0) {
+            if (count > 0) { *dirty = 1; }
+            else if (errno != EINTR) { break; }
+        }
+
+        waitpid(pid, NULL, 0); // The SIGCHLD handler may get to it first, which is fine
+    }
+
+    close(output[0]);
+    return branch;
+}
+
+
+/* Find the cached git status for a directory, NULL if there isn't one. gitLock must be held */
+GitStatus *findGitStatus(char *directory) {
+    for (int i = 0; i < GIT_CACHE_SIZE; ++i) {
+        if (gitCache[i].directory != NULL && strcmp(gitCache[i].directory, directory) == 0) { return &gitCache[i]; }
+    }
+
+    return NULL;
+}
+
+
+/* Run by the git status thread. Wait for a git status to be wanted, work it out, then wake the line editor */
+void *gitWorker(void *unused) {
+    (void) unused;
+    pthread_mutex_lock(&gitLock);
+
+    for (;;) {
+        // The most recently used directory is the one most likely to be on screen
+        GitStatus *next = NULL;
+        for (int i = 0; i < GIT_CACHE_SIZE; ++i) {
+            if (gitCache[i].pending == 1 && (next == NULL || gitCache[i].used > next->used)) { next = &gitCache[i]; }
+        }
+
+        if (next == NULL) {
+            pthread_cond_wait(&gitRequest, &gitLock);
+            continue;
+        }
+
+        char *directory = strdup(next->directory);
+        int generation = promptGeneration;
+        next->pending = 2; // Being worked out
+
+        pthread_mutex_unlock(&gitLock);
+
+        int dirty;
+        char *branch = gitStatus(directory, &dirty);
+
+        pthread_mutex_lock(&gitLock);
+
+        // The slot may have been given to another directory in the meantime
+        GitStatus *status = findGitStatus(directory);
+        if (status != NULL) {
+            free(status->branch);
+            status->branch = branch;
+            status->dirty = dirty;
+            status->generation = generation;
+
+            // If a command was run while git was, work it out again straight away
+            status->pending = (generation != promptGeneration) ? 1 : 0;
+        } else {
+            free(branch);
+        }
+
+        free(directory);
+
+        write(gitPipe[1], "", 1); // Wake up the line editor
+    }
+
+    return NULL;
+}
+
+
+/* git - The git branch checked out, and * if any tracked files have been changed. Worked out in the background */
+void renderGit(PromptText *prompt) {
+    char *directory = getCwd();
+    char text[256] = "";
+
+    pthread_mutex_lock(&gitLock);
+
+    GitStatus *status = findGitStatus(directory);
+
+    // Not seen this directory recently, replace the least recently used status
+    if (status == NULL) {
+        status = &gitCache[0];
+        for (int i = 1; i < GIT_CACHE_SIZE; ++i) {
+            if (gitCache[i].used < status->used) { status = &gitCache[i]; }
+        }
+
+        free(status->directory);
+        free(status->branch);
+        *status = (GitStatus) { strdup(directory), NULL, 0, -1, 0, 0 };
+    }
+
+    status->used = ++gitClock;
+
+    // Out of date, so work it out again. The thread and its pipe are only created the first time they are needed
+    if (status->generation != promptGeneration && status->pending == 0) {
+        if (gitPipe[0] < 0 && pipe2(gitPipe, O_CLOEXEC | O_NONBLOCK) == 0 && startThread(&gitThread, gitWorker) != 0) {
+            close(gitPipe[0]);
+            close(gitPipe[1]);
+            gitPipe[0] = gitPipe[1] = -1;
+        }
+
+        if (gitPipe[0] >= 0) {
+            status->pending = 1;
+            pthread_cond_signal(&gitRequest);
+        }
+    }
+
+    if (status->branch != NULL) { snprintf(text, sizeof(text), "(%s%s)", status->branch, status->dirty ? "*" : ""); }
+
+    pthread_mutex_unlock(&gitLock);
+
+    if (text[0] != '\0') { addSegment(prompt, COLOUR_YELLOW, text); }
+}
+
+
+Segment SEGMENTS[] = {
+    { "cwd", renderCwd },
+    { "git", renderGit },
+    { "status", renderStatus },
+    { "duration", renderDuration },
+    { "jobs", renderJobs },
+};
+
+
+/* Read PROMPT_SEGMENTS to find which segments to show, ignoring any names that aren't segments */
+void readSegments() {
+    char *names = getenv("PROMPT_SEGMENTS");
+    names = strdup(names != NULL ? names : PROMPT_DEFAULT);
+    nSegments = 0;
+
+    for (char *name = strtok(names, " ,"); name != NULL && nSegments < PROMPT_MAX_SEGMENTS; name = strtok(NULL, " ,")) {
+        for (size_t i = 0; i < sizeof(SEGMENTS) / sizeof(SEGMENTS[0]); ++i) {
+            if (strcmp(name, SEGMENTS[i].name) == 0) { promptSegments[nSegments++] = &SEGMENTS[i]; }
+        }
+    }
+
+    free(names);
+}
+
+
+/**
+ * Build the prompt from each of its segments, followed by PROMPT
+ * Nothing here waits, segments worked out in the background show what was last known
+ *
+ * @param columns Set to the number of columns the prompt takes up, so that the line editor knows where the line starts
+ * @return The prompt, valid until the next call
+ */
+char *buildPrompt(int *columns) {
+    if (nSegments < 0) { readSegments(); }
+
+    promptText.length = 0;
+    promptText.columns = 0;
+
+    for (int i = 0; i < nSegments; ++i) { promptSegments[i]->render(&promptText); }
+
+    addText(&promptText, COLOUR_BLUE, PROMPT); // The prompt itself follows straight on from the last segment
+
+    *columns = promptText.columns;
+    return promptText.text;
+}
+
+
+/* Work out the cwd segment again next time the prompt is built, e.g. after changing directory */
+void promptChanged() {
+    free(cwdText);
+    cwdText = NULL;
+}
+
+
+/* A command has been run, so anything worked out in the background may now be out of date */
+void segmentsStale() {
+    pthread_mutex_lock(&gitLock);
+    promptGeneration++;
+    pthread_mutex_unlock(&gitLock);
+}
+
+
+/* The line editor waits on this as well as the terminal, so that it can redraw the prompt when there is fresh data */
+int segmentsFd() {
+    return gitPipe[0];
+}
+
+
+/* Read everything waiting on segmentsFd() */
+void segmentsDrain() {
+    char buffer[64];
+    while (read(gitPipe[0], buffer, sizeof(buffer)) > 0) {}
+}
@@ -0,0 +1,104 @@
+// Here we count where the shell spends its time and memory, shown by the shellstats builtin
+// Each hot stage of running a command (see Timer) is timed on the monotonic clock, which costs a few tens of
+// nanoseconds per stage. Every allocation the shell makes is counted too, along with the number of bytes asked for, by
+// replacing malloc() and friends with the counted versions below, see stats.h. Allocations made inside the C library,
+// e.g. by getline(), aren't counted, but are included in the heap in use. Set SHELLSTATS to show the stats on exit
+
+char *TIMER_NAMES[TIMER_COUNT] = { "input", "complete", "history", "alias", "parse", "glob", "builtin", "launch", "wait" };
+
+TimerStats timers[TIMER_COUNT]; // Time spent in each stage, since the shell started or the stats were reset
+long long allocations = 0; // Number of allocations, including each realloc()
+long long allocatedBytes = 0; // Bytes asked for by those allocations
+long long frees = 0; // Number of allocations freed
+
+
+/* Nanoseconds on the monotonic clock, for timing */
+long long nanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+
+/**
+ * Add the time since started to a timer
+ * @param timer The timer
+ * @param started When the stage started, a time from nanoseconds()
+ */
+void stopTimer(Timer timer, long long started) {
+    long long taken = nanoseconds() - started;
+
+    timers[timer].count++;
+    timers[timer].nanoseconds += taken;
+    if (taken > timers[timer].longest) { timers[timer].longest = taken; }
+}
+
+
+/* Count an allocation. History is loaded by another thread, so the counts are updated atomically */
+void countAllocation(size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocatedBytes, (long long) size, __ATOMIC_RELAXED);
+}
+
+
+// The real functions are called with their names in brackets, so that the macros in stats.h aren't expanded
+
+void *countedMalloc(size_t size) {
+    countAllocation(size);
+    return (malloc)(size);
+}
+
+void *countedCalloc(size_t n, size_t size) {
+    countAllocation(n * size);
+    return (calloc)(n, size);
+}
+
+void *countedRealloc(void *memory, size_t size) {
+    countAllocation(size);
+    return (realloc)(memory, size);
+}
+
+char *countedStrdup(const char *text) {
+    countAllocation(strlen(text) + 1);
+    return (strdup)(text);
+}
+
+char *countedStrndup(const char *text, size_t length) {
+    countAllocation(strnlen(text, length) + 1);
+    return (strndup)(text, length);
+}
+
+void countedFree(void *memory) {
+    if (memory != NULL) { __atomic_add_fetch(&frees, 1, __ATOMIC_RELAXED); }
+    (free)(memory);
+}
+
+
+/* Display every timer, along with how many allocations have been made and how much memory is in use */
+void dispStats() {
+    blue(" = Shell Stats Begin =\n");
+    printf(" %-10s%10s%14s%14s%14s\n", "Stage", "Count", "Total (ms)", "Mean (us)", "Max (us)");
+
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        TimerStats *timer = &timers[i];
+        double mean = (timer->count > 0) ? timer->nanoseconds / 1000.0 / timer->count : 0;
+
+        printf(" %-10s%10lli%14.3f%14.2f%14.2f\n", TIMER_NAMES[i], timer->count, timer->nanoseconds / 1000000.0, mean,
+               timer->longest / 1000.0);
+    }
+
+    struct mallinfo2 heap = mallinfo2();
+    printf(" Allocations: %lli (%lli bytes), %lli freed. Heap in use: %zu bytes\n", allocations, allocatedBytes, frees,
+           heap.uordblks + heap.hblkhd);
+
+    blue(" = Shell Stats End =\n");
+}
+
+
+/* Set every timer and allocation count back to 0 */
+void resetStats() {
+    memset(timers, 0, sizeof(timers));
+    __atomic_store_n(&allocations, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&allocatedBytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&frees, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,732 @@
+// Here we define builtins for small utilities that scripts run over and over, such as echo and test
+// Each of these is also a system command, but running them inside the shell saves starting a process every time.
+// They behave as POSIX (and GNU, where it adds options) describes. "command <name>" runs the system command instead,
+// and "enable -n <name>" turns the builtin off altogether, see builtinCommand() and builtinEnable()
+
+char *ESCAPES = "\\\\a\ab\be\33f\fn\nr\rt\tv\v"; // Each escape character, followed by the character it stands for
+volatile sig_atomic_t sleepInterrupted = 0; // Set by Ctrl+C while the sleep builtin is waiting
+
+
+/**
+ * Display an error from a utility on stderr, as the system command would, so that e.g. "sleep x 2>/dev/null" is silent
+ * @param format printf() format of the message, which follows "[Error] "
+ */
+void utilityError(char *format, ...) {
+    va_list args;
+
+    fflush(stdout); // Anything printed before the error should appear before it
+    if (useColour && isatty(STDERR_FILENO)) { fputs(COLOUR_RED "[Error] " COLOUR_RESET, stderr); }
+    else { fputs("[Error] ", stderr); }
+
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+
+/**
+ * Expand the backslash escapes in text, as used by echo -e, printf and printf's %b
+ *      \\ \a \b \e \f \n \r \t \v  The usual control characters
+ *      \c                          Stop, nothing more is printed
+ *      \0nnn or \nnn               The character with octal value nnn, \0 is required by echo and %b but not by printf
+ *      \xHH                        The character with hexadecimal value HH
+ *
+ * @param text The text to expand
+ * @param out Filled with the expanded text, which is never longer than text. May contain NUL characters
+ * @param octalZero 1 if octal escapes begin with \0, as for echo and %b
+ * @param stop Set to 1 if \c was found
+ * @return Number of bytes written to out
+ */
+size_t expandEscapes(char *text, char *out, int octalZero, int *stop) {
+    char *w = out;
+
+    for (char *r = text; *r; ++r) {
+        if (*r != '\\' || r[1] == 0) {
+            *w++ = *r;
+            continue;
+        }
+
+        char *escape = strchr(ESCAPES, *++r);
+
+        if (escape != NULL && (escape - ESCAPES) % 2 == 0) {
+            *w++ = escape[1];
+        } else if (*r == 'c') {
+            *stop = 1;
+            break;
+        } else if ((*r == '0' && octalZero) || (*r >= '0' && *r <= '7' && !octalZero)) {
+            int value = 0;
+            char *digit = octalZero ? r + 1 : r;
+
+            for (int i = 0; i < 3 && *digit >= '0' && *digit <= '7'; ++i) { value = value * 8 + *digit++ - '0'; }
+            *w++ = (char) value;
+            r = digit - 1;
+        } else if (*r == 'x' && isxdigit((unsigned char) r[1])) {
+            int value = 0;
+
+            for (int i = 0; i < 2 && isxdigit((unsigned char) r[1]); ++i) {
+                ++r;
+                value = value * 16 + (isdigit((unsigned char) *r) ? *r - '0' : tolower((unsigned char) *r) - 'a' + 10);
+            }
+            *w++ = (char) value;
+        } else { // Not an escape, kept as it is
+            *w++ = '\\';
+            *w++ = *r;
+        }
+    }
+
+    return w - out;
+}
+
+
+/* echo [-neE] [text...] - Print the text. -n leaves off the newline, -e expands backslash escapes, -E doesn't */
+int builtinEcho(int n, char *tokens[]) {
+    int newline = 1;
+    int escapes = 0;
+    int i = 1;
+
+    // Options, which can be combined, e.g. -ne. Anything else beginning with - is printed, as GNU echo does
+    for (; i < n && tokens[i][0] == '-' && tokens[i][1] != 0 && tokens[i][strspn(tokens[i] + 1, "neE") + 1] == 0; ++i) {
+        for (char *option = tokens[i] + 1; *option; ++option) {
+            if (*option == 'n') { newline = 0; }
+            else { escapes = (*option == 'e'); }
+        }
+    }
+
+    for (; i < n; ++i) {
+        if (escapes) {
+            int stop = 0;
+            char *expanded = malloc(strlen(tokens[i]) + 1);
+
+            fwrite(expanded, 1, expandEscapes(tokens[i], expanded, 1, &stop), stdout);
+            free(expanded);
+            if (stop) { return 0; }
+        } else {
+            fputs(tokens[i], stdout);
+        }
+
+        if (i < n - 1) { putchar(' '); }
+    }
+
+    if (newline) { putchar('\n'); }
+    return 0;
+}
+
+
+/* pwd [-L|-P] - Print the current working directory */
+int builtinPwd(int n, char *tokens[]) {
+    if (n == 2 && strcmp(tokens[1], "-L") != 0 && strcmp(tokens[1], "-P") != 0) {
+        utilityError("Unknown option \"%s\". Try calling \"pwd\"\n", tokens[1]);
+        return 2;
+    }
+
+    // The shell doesn't keep track of symbolic links it has followed, so -L and -P are the same
+    printf("%s\n", getCwd());
+    return 0;
+}
+
+
+/* true - Do nothing, successfully */
+int builtinTrue(int n, char *tokens[]) {
+    (void) n;
+    (void) tokens;
+    return 0;
+}
+
+
+/* false - Do nothing, unsuccessfully */
+int builtinFalse(int n, char *tokens[]) {
+    (void) n;
+    (void) tokens;
+    return 1;
+}
+
+
+/**
+ * Read a whole number for test, e.g. for -eq
+ * @param text The number
+ * @param value Set to the number
+ * @return 0 on success, 1 if text is not a whole number. An error will have been displayed
+ */
+int testNumber(char *text, long long *value) {
+    char *end;
+    errno = 0;
+    *value = strtoll(text, &end, 10);
+
+    while (isspace((unsigned char) *end)) { end++; }
+
+    if (end == text || *end != 0 || errno != 0) {
+        utilityError("test: \"%s\" is not a whole number\n", text);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/* Return if op is one of test's unary operators, such as -f */
+int isTestUnary(char *op) {
+    return op[0] == '-' && op[1] != 0 && op[2] == 0 && strchr("bcdefghLnprsStuwxz", op[1]) != NULL;
+}
+
+
+/* Return if op is one of test's binary operators, such as -eq */
+int isTestBinary(char *op) {
+    char *BINARY[] = { "=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", "-nt", "-ot", "-ef" };
+
+    for (int i = 0; i < (int) (sizeof(BINARY) / sizeof(BINARY[0])); ++i) {
+        if (strcmp(op, BINARY[i]) == 0) { return 1; }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Evaluate one of test's unary operators, e.g. -f file
+ * @param op The operator, see isTestUnary()
+ * @param arg Its argument
+ * @return 0 if true, 1 if false
+ */
+int testUnary(char *op, char *arg) {
+    struct stat info;
+
+    switch (op[1]) {
+        case 'n': return arg[0] == 0;
+        case 'z': return arg[0] != 0;
+        case 't': return !isatty(atoi(arg));
+        case 'r': return access(arg, R_OK) != 0;
+        case 'w': return access(arg, W_OK) != 0;
+        case 'x': return access(arg, X_OK) != 0;
+        case 'h':
+        case 'L': return lstat(arg, &info) != 0 || !S_ISLNK(info.st_mode);
+    }
+
+    if (stat(arg, &info) != 0) { return 1; }
+
+    switch (op[1]) {
+        case 'b': return !S_ISBLK(info.st_mode);
+        case 'c': return !S_ISCHR(info.st_mode);
+        case 'd': return !S_ISDIR(info.st_mode);
+        case 'f': return !S_ISREG(info.st_mode);
+        case 'g': return !(info.st_mode & S_ISGID);
+        case 'p': return !S_ISFIFO(info.st_mode);
+        case 's': return info.st_size == 0;
+        case 'S': return !S_ISSOCK(info.st_mode);
+        case 'u': return !(info.st_mode & S_ISUID);
+        default: return 0; // -e
+    }
+}
+
+
+/**
+ * Evaluate one of test's binary operators, e.g. 1 -lt 2
+ * @param left The left argument
+ * @param op The operator, see isTestBinary()
+ * @param right The right argument
+ * @return 0 if true, 1 if false, 2 if a number was expected but not given
+ */
+int testBinary(char *left, char *op, char *right) {
+    if (op[0] != '-') { // String comparisons
+        int compared = strcmp(left, right);
+
+        if (op[0] == '!') { return compared == 0; }
+        if (op[0] == '<') { return compared >= 0; }
+        if (op[0] == '>') { return compared <= 0; }
+        return compared != 0;
+    }
+
+    if (strcmp(op, "-nt") == 0 || strcmp(op, "-ot") == 0 || strcmp(op, "-ef") == 0) { // File comparisons
+        struct stat a, b;
+        int haveA = stat(left, &a) == 0;
+        int haveB = stat(right, &b) == 0;
+
+        if (op[1] == 'e') { return !(haveA && haveB && a.st_dev == b.st_dev && a.st_ino == b.st_ino); }
+
+        struct timespec *newer = (op[1] == 'n') ? &a.st_mtim : &b.st_mtim;
+        struct timespec *older = (op[1] == 'n') ? &b.st_mtim : &a.st_mtim;
+
+        if (!(op[1] == 'n' ? haveA : haveB)) { return 1; }
+        if (!(op[1] == 'n' ? haveB : haveA)) { return 0; } // Anything is newer than a file that doesn't exist
+        return !(newer->tv_sec > older->tv_sec || (newer->tv_sec == older->tv_sec && newer->tv_nsec > older->tv_nsec));
+    }
+
+    long long a, b;
+    if (testNumber(left, &a) != 0 || testNumber(right, &b) != 0) { return 2; }
+
+    if (strcmp(op, "-eq") == 0) { return !(a == b); }
+    if (strcmp(op, "-ne") == 0) { return !(a != b); }
+    if (strcmp(op, "-lt") == 0) { return !(a < b); }
+    if (strcmp(op, "-le") == 0) { return !(a <= b); }
+    if (strcmp(op, "-gt") == 0) { return !(a > b); }
+    return !(a >= b); // -ge
+}
+
+
+int testOr(char *args[], int n, int *pos);
+
+/**
+ * Evaluate a single condition of a longer test expression: ( expression ), ! condition, a unary or binary operator,
+ * or a string, which is true if it isn't empty
+ * @param args The arguments to test
+ * @param n Number of arguments
+ * @param pos Index of the next argument, moved past the condition
+ * @return 0 if true, 1 if false, 2 on error
+ */
+int testPrimary(char *args[], int n, int *pos) {
+    if (*pos >= n) {
+        utilityError("test: Expected an argument after \"%s\"\n", args[n - 1]);
+        return 2;
+    }
+
+    char *arg = args[(*pos)++];
+
+    if (strcmp(arg, "!") == 0) {
+        int result = testPrimary(args, n, pos);
+        return (result == 2) ? 2 : !result;
+    }
+
+    if (strcmp(arg, "(") == 0) {
+        int result = testOr(args, n, pos);
+
+        if (result != 2 && (*pos >= n || strcmp(args[*pos], ")") != 0)) {
+            utilityError("test: Missing \")\"\n");
+            return 2;
+        }
+
+        (*pos)++;
+        return result;
+    }
+
+    if (*pos < n && isTestBinary(args[*pos])) {
+        if (*pos + 1 >= n) {
+            utilityError("test: Expected an argument after \"%s\"\n", args[*pos]);
+            return 2;
+        }
+
+        *pos += 2;
+        return testBinary(arg, args[*pos - 2], args[*pos - 1]);
+    }
+
+    if (isTestUnary(arg) && *pos < n) { return testUnary(arg, args[(*pos)++]); }
+
+    return arg[0] == 0;
+}
+
+
+/* Evaluate conditions joined by -a, see testPrimary() */
+int testAnd(char *args[], int n, int *pos) {
+    int result = testPrimary(args, n, pos);
+
+    while (result != 2 && *pos < n && strcmp(args[*pos], "-a") == 0) {
+        (*pos)++;
+        int next = testPrimary(args, n, pos);
+        result = (next == 2) ? 2 : (result || next);
+    }
+
+    return result;
+}
+
+
+/* Evaluate conditions joined by -o, which binds less tightly than -a, see testPrimary() */
+int testOr(char *args[], int n, int *pos) {
+    int result = testAnd(args, n, pos);
+
+    while (result != 2 && *pos < n && strcmp(args[*pos], "-o") == 0) {
+        (*pos)++;
+        int next = testAnd(args, n, pos);
+        result = (next == 2) ? 2 : (result && next);
+    }
+
+    return result;
+}
+
+
+/**
+ * Evaluate a test expression. Up to four arguments are evaluated as POSIX lays out, so that e.g. "test -n" and
+ * "test ! = x" mean what they do in other shells. Longer expressions are parsed with -o binding less tightly than -a
+ *
+ * @param args The arguments to test
+ * @param n Number of arguments
+ * @return 0 if true, 1 if false, 2 on error
+ */
+int testExpression(char *args[], int n) {
+    if (n == 0) { return 1; }
+    if (n == 1) { return args[0][0] == 0; }
+
+    if (n == 2) {
+        if (strcmp(args[0], "!") == 0) { return args[1][0] != 0; }
+        if (isTestUnary(args[0])) { return testUnary(args[0], args[1]); }
+    }
+
+    if (n == 3) {
+        if (isTestBinary(args[1])) { return testBinary(args[0], args[1], args[2]); }
+        if (strcmp(args[0], "!") == 0) {
+            int result = testExpression(args + 1, 2);
+            return (result == 2) ? 2 : !result;
+        }
+        if (strcmp(args[0], "(") == 0 && strcmp(args[2], ")") == 0) { return args[1][0] == 0; }
+    }
+
+    if (n == 4) {
+        if (strcmp(args[0], "!") == 0) {
+            int result = testExpression(args + 1, 3);
+            return (result == 2) ? 2 : !result;
+        }
+        if (strcmp(args[0], "(") == 0 && strcmp(args[3], ")") == 0) { return testExpression(args + 1, 2); }
+    }
+
+    int pos = 0;
+    int result = testOr(args, n, &pos);
+
+    if (result != 2 && pos < n) {
+        utilityError("test: Unexpected \"%s\"\n", args[pos]);
+        return 2;
+    }
+
+    return result;
+}
+
+
+/* test <expression> - Check a condition, e.g. "test -f file" or "test 1 -lt 2" */
+int builtinTest(int n, char *tokens[]) {
+    return testExpression(tokens + 1, n - 1);
+}
+
+
+/* [ <expression> ] - The same as test, but ending with ] */
+int builtinBracket(int n, char *tokens[]) {
+    if (strcmp(tokens[n - 1], "]") != 0) {
+        utilityError("[: Missing \"]\". Try calling \"[ <expression> ]\"\n");
+        return 2;
+    }
+
+    return testExpression(tokens + 1, n - 2);
+}
+
+
+/**
+ * Read a number for one of printf's numeric conversions. As in other shells, 'c or "c is the value of the character c
+ * @param text The number, or NULL if there are no arguments left, which is 0
+ * @param end Set to where the number ended, so that it can be checked for anything left over
+ * @param isFloat 1 to read a floating point number into real, otherwise a whole number into whole
+ * @param whole Set to the number, if it is a whole number
+ * @param real Set to the number, if it is a floating point number
+ */
+void printfNumber(char *text, char **end, int isFloat, long long *whole, double *real) {
+    static char *EMPTY = "";
+
+    if (text == NULL) { text = EMPTY; }
+    *end = text;
+    *whole = 0;
+    *real = 0;
+    errno = 0;
+
+    if (text[0] == '\'' || text[0] == '"') {
+        *whole = (unsigned char) text[1];
+        *real = *whole;
+        *end = text + strlen(text); // Anything after the character is ignored
+        return;
+    }
+
+    if (isFloat) { *real = strtod(text, end); }
+    else if (text[0] == '-') { *whole = strtoll(text, end, 0); }
+    else { *whole = (long long) strtoull(text, end, 0); }
+}
+
+
+/**
+ * Print the format once, taking arguments for its conversions as they are needed
+ * @param format The format, as for printf(3), with backslash escapes
+ * @param args Arguments for the conversions
+ * @param n Number of arguments
+ * @param next Index of the next argument, moved past those used
+ * @param status Set to 1 if an argument was not a valid number
+ * @return 1 if printing should stop, because of \c or an invalid conversion, otherwise 0
+ */
+int printfOnce(char *format, char *args[], int n, int *next, int *status) {
+    for (char *r = format; *r; ++r) {
+        // Expand just this escape, then carry on after it. An escape is at most 4 characters, e.g. \101 or \x41
+        if (*r == '\\') {
+            char escape[5] = { 0 };
+            char out[5];
+            int stop = 0;
+            size_t length = 2;
+
+            if (r[1] == 0) { length = 1; }
+            else if (r[1] >= '0' && r[1] <= '7') { length = 1 + strspn(r + 1, "01234567"); }
+            else if (r[1] == 'x') { length = 2 + strspn(r + 2, "0123456789abcdefABCDEF"); }
+            if (length > 4) { length = 4; }
+
+            memcpy(escape, r, length);
+            fwrite(out, 1, expandEscapes(escape, out, 0, &stop), stdout);
+            if (stop) { return 1; }
+
+            r += length - 1;
+            continue;
+        }
+
+        if (*r != '%') {
+            putchar(*r);
+            continue;
+        }
+
+        if (r[1] == '%') {
+            putchar('%');
+            r++;
+            continue;
+        }
+
+        // Build up the conversion, filling in any * with the next argument, e.g. "%-*d" with 5 becomes "%-5d"
+        char spec[64];
+        int length = 0;
+        spec[length++] = '%';
+
+        for (r++; *r && strchr("-+ #0", *r) && length < 8; ++r) { spec[length++] = *r; }
+
+        for (int part = 0; part < 2; ++part) { // Width, then precision
+            if (part == 1) {
+                if (*r != '.') { break; }
+                spec[length++] = *r++;
+            }
+
+            if (*r == '*') {
+                long long value;
+                double unused;
+                char *end;
+
+                printfNumber(*next < n ? args[(*next)++] : NULL, &end, 0, &value, &unused);
+                if (value < 0 && part == 0) { spec[length++] = '-'; value = -value; }
+                if (value < 0) { value = 0; }
+                length += snprintf(spec + length, 24, "%lli", value % 1000000);
+                r++;
+            } else {
+                while (isdigit((unsigned char) *r) && length < 40) { spec[length++] = *r++; }
+            }
+        }
+
+        char conversion = *r;
+        char *arg = (*next < n) ? args[(*next)++] : NULL;
+
+        if (conversion == 0 || strchr("sbcdiouxXfFeEgGaA", conversion) == NULL) {
+            utilityError("printf: \"%%%c\" is not a valid conversion\n", conversion);
+            *status = 1;
+            return 1;
+        }
+
+        if (conversion == 's' || conversion == 'b' || conversion == 'c') {
+            char *text = (arg != NULL) ? arg : "";
+            char *expanded = NULL;
+            int stop = 0;
+
+            if (conversion == 'b') {
+                expanded = malloc(strlen(text) + 1);
+                expanded[expandEscapes(text, expanded, 1, &stop)] = 0;
+                text = expanded;
+            }
+
+            spec[length++] = (conversion == 'c') ? 'c' : 's';
+            spec[length] = 0;
+
+            if (conversion == 'c') { if (text[0] != 0) { printf(spec, text[0]); } }
+            else { printf(spec, text); }
+
+            free(expanded);
+            if (stop) { return 1; }
+            continue;
+        }
+
+        int isFloat = strchr("fFeEgGaA", conversion) != NULL;
+        long long whole;
+        double real;
+        char *end;
+
+        printfNumber(arg, &end, isFloat, &whole, &real);
+
+        if (arg != NULL && (*end != 0 || end == arg || errno != 0)) {
+            utilityError("printf: \"%s\" is not a valid number\n", arg);
+            *status = 1;
+        }
+
+        if (isFloat) {
+            spec[length++] = conversion;
+            spec[length] = 0;
+            printf(spec, real);
+        } else {
+            spec[length++] = 'l';
+            spec[length++] = 'l';
+            spec[length++] = (conversion == 'i') ? 'd' : conversion;
+            spec[length] = 0;
+            printf(spec, whole);
+        }
+    }
+
+    return 0;
+}
+
+
+/* printf <format> [argument...] - Print the arguments as the format describes, reusing it until they are all used */
+int builtinPrintf(int n, char *tokens[]) {
+    int next = 2;
+    int status = 0;
+
+    for (;;) {
+        int first = next;
+        if (printfOnce(tokens[1], tokens, n, &next, &status) != 0) { break; }
+        if (next >= n || next == first) { break; } // Every argument used, or the format doesn't use any
+    }
+
+    return status;
+}
+
+
+/* SIGINT handler while sleeping, so that Ctrl+C ends the sleep rather than the shell */
+void interruptSleep(int signal) {
+    (void) signal;
+    sleepInterrupted = 1;
+}
+
+
+/* sleep <seconds>... - Wait for the total of the times given, which may have a suffix of s, m, h or d */
+int builtinSleep(int n, char *tokens[]) {
+    double total = 0;
+
+    for (int i = 1; i < n; ++i) {
+        char *end;
+        double seconds = strtod(tokens[i], &end);
+        char *units = "smhd";
+        double scale[] = { 1, 60, 3600, 86400 };
+
+        if (end == tokens[i] || seconds < 0 || (*end != 0 && (end[1] != 0 || strchr(units, *end) == NULL))) {
+            utilityError("sleep: \"%s\" is not a valid time. Try calling \"sleep <seconds>\", e.g. \"sleep 0.5\" or \"sleep 1m\"\n", tokens[i]);
+            return 1;
+        }
+
+        total += seconds * ((*end != 0) ? scale[strchr(units, *end) - units] : 1);
+    }
+
+    struct timespec remaining = { (time_t) total, (long) ((total - (time_t) total) * 1000000000) };
+    struct sigaction action, saved;
+
+    // The shell has the terminal while a builtin runs, so Ctrl+C would otherwise end the shell itself
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interruptSleep;
+    sigemptyset(&action.sa_mask);
+    if (interactive) { sigaction(SIGINT, &action, &saved); }
+    sleepInterrupted = 0;
+
+    fflush(stdout);
+    while (nanosleep(&remaining, &remaining) != 0 && errno == EINTR && !sleepInterrupted) { } // e.g. SIGCHLD
+
+    if (interactive) { sigaction(SIGINT, &saved, NULL); }
+    if (sleepInterrupted) { printf("\n"); }
+
+    return sleepInterrupted ? 128 + SIGINT : 0;
+}
+
+
+/**
+ * Find a signal from its name or number, e.g. "TERM", "SIGTERM", "term" or "15"
+ * @param name The signal
+ * @return The signal number, or -1 if there is no such signal
+ */
+int signalNumber(char *name) {
+    if (isdigit((unsigned char) name[0])) {
+        char *end;
+        long number = strtol(name, &end, 10);
+        return (*end == 0 && number >= 0 && number < NSIG) ? number : -1;
+    }
+
+    if (strncasecmp(name, "SIG", 3) == 0) { name += 3; }
+
+    for (int signal = 1; signal < NSIG; ++signal) {
+        const char *abbreviation = sigabbrev_np(signal);
+        if (abbreviation != NULL && strcasecmp(name, abbreviation) == 0) { return signal; }
+    }
+
+    return -1;
+}
+
+
+/* kill [-s <signal> | -<signal>] <pid|%job>... or kill -l [status] - Send a signal, by default TERM, or list signals */
+int builtinKill(int n, char *tokens[]) {
+    int signal = SIGTERM;
+    int i = 1;
+
+    // kill -l [status], list every signal, or name the signal that ended a command with the given exit status
+    if (strcmp(tokens[1], "-l") == 0) {
+        if (n == 2) {
+            for (int s = 1; s < NSIG; ++s) {
+                if (sigabbrev_np(s) != NULL) { printf("%2i) SIG%s\n", s, sigabbrev_np(s)); }
+            }
+            return 0;
+        }
+
+        int status = 0;
+        for (i = 2; i < n; ++i) {
+            int number = isdigit((unsigned char) tokens[i][0]) ? atoi(tokens[i]) : signalNumber(tokens[i]);
+            if (number > 128) { number -= 128; } // The exit status of a command killed by the signal
+
+            if (number <= 0 || number >= NSIG || sigabbrev_np(number) == NULL) {
+                utilityError("kill: \"%s\" is not a valid signal\n", tokens[i]);
+                status = 1;
+            } else if (isdigit((unsigned char) tokens[i][0])) {
+                printf("%s\n", sigabbrev_np(number));
+            } else {
+                printf("%i\n", number);
+            }
+        }
+        return status;
+    }
+
+    // The signal, as -s <signal>, -<signal>, or -- before the targets
+    if (strcmp(tokens[1], "-s") == 0 && n > 2) {
+        signal = signalNumber(tokens[2]);
+        i = 3;
+    } else if (strcmp(tokens[1], "--") == 0) {
+        i = 2;
+    } else if (tokens[1][0] == '-') {
+        signal = signalNumber(tokens[1] + 1);
+        i = 2;
+    }
+
+    if (signal < 0) {
+        utilityError("kill: \"%s\" is not a valid signal. Try calling \"kill -l\" to see every signal\n", tokens[i - 1]);
+        return 1;
+    }
+
+    if (i >= n) {
+        utilityError("Nothing to signal. Try calling \"kill [-s <signal>] <pid|%%job>\"\n");
+        return 2;
+    }
+
+    int status = 0;
+    blockChildSignal(1); // So that a job can't be removed while we signal it
+
+    for (; i < n; ++i) {
+        if (tokens[i][0] == '%') {
+            Job *job = findJob(tokens[i]);
+            if (job == NULL) {
+                status = 1;
+                continue;
+            }
+
+            kill(-job->pgid, signal);
+            if (job->stopped > 0 && (signal == SIGTERM || signal == SIGHUP)) { kill(-job->pgid, SIGCONT); } // So it gets it
+            continue;
+        }
+
+        char *end;
+        long pid = strtol(tokens[i], &end, 10);
+
+        if (*end != 0 || end == tokens[i]) {
+            utilityError("kill: \"%s\" is not a process or job. Try calling \"kill [-s <signal>] <pid|%%job>\"\n", tokens[i]);
+            status = 1;
+        } else if (kill(pid, signal) != 0) {
+            utilityError("kill: %s: %s\n", tokens[i], strerror(errno));
+            status = 1;
+        }
+    }
+
+    blockChildSignal(0);
+    return status;
+}
@@ -0,0 +1,250 @@
+// Here we launch commands through a zygote, a small helper process forked from the shell as it starts (see -z)
+// Forking copies the shell's page tables, so the longer the shell runs and the more memory it uses, the slower fork
+// gets. The zygote is forked while the shell is still small and stays small. It waits for requests on a socket, each
+// holding a command along with its file descriptors (passed with SCM_RIGHTS), working directory and environment. Each
+// command is started with clone(CLONE_PARENT), which makes it a child of the shell rather than of the zygote, so it is
+// reaped and joins its job exactly as if the shell had forked it. The zygote replies with the new pid, once the
+// command has been exec'd, or with the reason it couldn't be.
+
+int zygoteSocket = -1; // The shell's end of the socket to the zygote, or -1 if there is no zygote
+pid_t zygotePid = 0; // Process id of the zygote
+
+
+/**
+ * Send everything in a buffer, or receive until it is full, as a stream socket may move it in several pieces
+ * @param fd The socket
+ * @param buffer The data to send, or space to receive into
+ * @param length Number of bytes
+ * @param sending 1 to send, 0 to receive
+ * @return 0 on success, -1 if the other end has gone or an error occurred
+ */
+int transferAll(int fd, char *buffer, size_t length, int sending) {
+    while (length > 0) {
+        ssize_t moved = sending ? send(fd, buffer, length, MSG_NOSIGNAL) : recv(fd, buffer, length, MSG_WAITALL);
+
+        if (moved < 0 && errno == EINTR) { continue; }
+        if (moved <= 0) { return -1; }
+
+        buffer += moved;
+        length -= moved;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Start a process for a request, in the zygote. Only system calls are made in the new process, as it shares nothing
+ * with the zygote's parent but was cloned from the zygote
+ *
+ * @param request The request
+ * @param fds stdin, stdout and stderr for the process, then the terminal if it is to be given it
+ * @param strings The path, working directory, arguments then environment, each NUL terminated
+ * @return The reply to send back to the shell
+ */
+ZygoteReply zygoteStart(ZygoteRequest *request, int fds[4], char *strings) {
+    char **argv = malloc((request->argc + 1) * sizeof(char *));
+    char **env = malloc((request->envc + 1) * sizeof(char *));
+    char *path = strings;
+    char *cwd = path + strlen(path) + 1;
+    char *next = cwd + strlen(cwd) + 1;
+
+    for (int i = 0; i < request->argc; ++i, next += strlen(next) + 1) { argv[i] = next; }
+    for (int i = 0; i < request->envc; ++i, next += strlen(next) + 1) { env[i] = next; }
+    argv[request->argc] = NULL;
+    env[request->envc] = NULL;
+
+    ZygoteReply reply = { -1, 0 };
+    int errors[2]; // The new process writes errno here if it can't exec, the pipe closing on exec means success
+
+    if (pipe2(errors, O_CLOEXEC) < 0) {
+        reply.error = errno;
+    } else {
+        pid_t pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, NULL, NULL, NULL, NULL);
+
+        if (pid == 0) { // The new process, a child of the shell
+            sigset_t none;
+            sigemptyset(&none);
+
+            setpgid(0, request->pgid);
+            if (request->foreground && fds[3] >= 0) { tcsetpgrp(fds[3], getpgrp()); }
+
+            // The zygote ignores these, the command should not inherit that
+            int signals[] = { SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD };
+            for (int i = 0; i < (int) (sizeof(signals) / sizeof(signals[0])); ++i) { signal(signals[i], SIG_DFL); }
+            sigprocmask(SIG_SETMASK, &none, NULL);
+
+            for (int fd = 0; fd < 3; ++fd) { dup2(fds[fd], fd); }
+
+            if (chdir(cwd) == 0) { execve(path, argv, env); }
+
+            int error = errno;
+            write(errors[1], &error, sizeof(error));
+            _exit(127);
+        }
+
+        close(errors[1]);
+
+        if (pid < 0) {
+            reply.error = errno;
+        } else {
+            reply.pid = pid;
+            if (read(errors[0], &reply.error, sizeof(reply.error)) <= 0) { reply.error = 0; } // Closed by exec
+        }
+
+        close(errors[0]);
+    }
+
+    free(argv);
+    free(env);
+    return reply;
+}
+
+
+/**
+ * The zygote's main loop, which launches a process for each request until the shell closes the socket
+ * @param fd The zygote's end of the socket
+ */
+void runZygote(int fd) {
+    // Keep away from the terminal's signals, which are for the shell and its commands
+    setpgid(0, 0);
+    int ignored[] = { SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGHUP };
+    for (int i = 0; i < (int) (sizeof(ignored) / sizeof(ignored[0])); ++i) { signal(ignored[i], SIG_IGN); }
+    signal(SIGCHLD, SIG_DFL); // Commands are the shell's children, never the zygote's
+
+    for (;;) {
+        ZygoteRequest request;
+        char control[CMSG_SPACE(4 * sizeof(int))];
+        struct iovec part = { &request, sizeof(request) };
+        struct msghdr message = { .msg_iov = &part, .msg_iovlen = 1, .msg_control = control,
+                                  .msg_controllen = sizeof(control) };
+
+        ssize_t got = recvmsg(fd, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+        if (got < 0 && errno == EINTR) { continue; }
+        if (got != sizeof(request)) { _exit(0); } // The shell has exited
+
+        int fds[4] = { -1, -1, -1, -1 };
+        struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+        if (header != NULL && header->cmsg_type == SCM_RIGHTS) {
+            memcpy(fds, CMSG_DATA(header), header->cmsg_len - CMSG_LEN(0));
+        }
+
+        char *strings = malloc(request.length);
+        if (transferAll(fd, strings, request.length, 0) != 0) { _exit(0); }
+
+        ZygoteReply reply = zygoteStart(&request, fds, strings);
+
+        free(strings);
+        for (int i = 0; i < 4; ++i) {
+            if (fds[i] >= 0) { close(fds[i]); }
+        }
+
+        if (transferAll(fd, (char *) &reply, sizeof(reply), 1) != 0) { _exit(0); }
+    }
+}
+
+
+/**
+ * Fork the zygote. This should be done as early as possible, while the shell is small
+ * @return 0 on success, 1 if the zygote couldn't be started. An error will have been displayed
+ */
+int startZygote() {
+    int fds[2];
+
+    if (zygoteSocket >= 0) { return 0; }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        red("[Error] ");
+        printf("Unable to start the zygote: %s\n", strerror(errno));
+        return 1;
+    }
+
+    fflush(stdout); // Don't let the zygote inherit anything waiting to be printed
+    zygotePid = fork();
+
+    if (zygotePid == 0) {
+        close(fds[0]);
+        runZygote(fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+
+    if (zygotePid < 0) {
+        red("[Error] ");
+        printf("Unable to start the zygote: %s\n", strerror(errno));
+        close(fds[0]);
+        return 1;
+    }
+
+    zygoteSocket = fds[0];
+    return 0;
+}
+
+
+/**
+ * Launch a command through the zygote, sending the stdin, stdout and stderr it should have along with the command
+ * Redirections have already been opened by the shell, see openRedirects()
+ *
+ * @param path Path to the executable, as found by hashLookup
+ * @param argv NULL terminated list of arguments, argv[0] being the command name
+ * @param io The process group the new process should join, and whether it is in the foreground
+ * @param fds File descriptors to use as the new process's stdin, stdout and stderr
+ * @param error Set to errno if the command couldn't be started
+ * @return The pid of the new process, or -1 if it couldn't be started. An error will have been displayed if the
+ *         zygote has gone, otherwise error says why
+ */
+pid_t zygoteLaunch(char *path, char **argv, LaunchIO *io, int fds[3], int *error) {
+    int passed[4] = { fds[STDIN_FILENO], fds[STDOUT_FILENO], fds[STDERR_FILENO],
+                      (io->foreground && shellTerminal >= 0) ? shellTerminal : -1 }; // Sent along with the request
+
+    *error = 0;
+
+    // The path, working directory, arguments and environment, one after another
+    ZygoteRequest request = { 0, 0, 0, io->pgid, passed[3] >= 0 };
+    char *cwd = getCwd();
+
+    request.length = strlen(path) + 1 + strlen(cwd) + 1;
+    for (; argv[request.argc] != NULL; ++request.argc) { request.length += strlen(argv[request.argc]) + 1; }
+    for (; environ[request.envc] != NULL; ++request.envc) { request.length += strlen(environ[request.envc]) + 1; }
+
+    char *strings = malloc(request.length);
+    char *w = stpcpy(strings, path) + 1;
+    w = stpcpy(w, cwd) + 1;
+    for (int i = 0; i < request.argc; ++i) { w = stpcpy(w, argv[i]) + 1; }
+    for (int i = 0; i < request.envc; ++i) { w = stpcpy(w, environ[i]) + 1; }
+
+    // The request itself carries the file descriptors, then the strings follow
+    int nFds = (passed[3] >= 0) ? 4 : 3;
+    char control[CMSG_SPACE(4 * sizeof(int))];
+    struct iovec part = { &request, sizeof(request) };
+    struct msghdr message = { .msg_iov = &part, .msg_iovlen = 1, .msg_control = control,
+                              .msg_controllen = CMSG_SPACE(nFds * sizeof(int)) };
+    struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+
+    memset(control, 0, sizeof(control));
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(nFds * sizeof(int));
+    memcpy(CMSG_DATA(header), passed, nFds * sizeof(int));
+
+    ZygoteReply reply;
+    ssize_t sent;
+    while ((sent = sendmsg(zygoteSocket, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR) {}
+
+    if (sent != sizeof(request) || transferAll(zygoteSocket, strings, request.length, 1) != 0
+        || transferAll(zygoteSocket, (char *) &reply, sizeof(reply), 0) != 0) {
+        // The zygote has gone, e.g. it was killed. Go back to launching commands directly
+        yellow("[Warning] ");
+        printf("The zygote has stopped, commands will be launched using spawn\n");
+        close(zygoteSocket);
+        zygoteSocket = -1;
+        launchMode = LAUNCH_SPAWN;
+        free(strings);
+        return -1;
+    }
+
+    free(strings);
+    *error = reply.error;
+    return reply.pid;
+}
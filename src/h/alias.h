@@ -0,0 +1,23 @@
+typedef struct {
+    char *name; // Name of the alias, e.g. ll. NULL if this slot is free
+    char *command; // Command as entered by the user, e.g. ls -l
+    char *expansion; // Command with any chain of aliases in its first word already expanded, e.g. ls --color -l
+} AliasEntry;
+
+/* Load aliases from the alias file in the users' home directory. Otherwise done the first time an alias is needed */
+void initialiseAlias();
+
+/* Add a new alias, or replace an existing one. Returns 0 on success, 1 if the alias would be circular */
+int addAlias(char *name, char *command);
+
+/* Remove an alias. Returns 0 on success, 1 if there is no such alias */
+int unAlias(char *name);
+
+/* Find the fully expanded command for an alias, given the first word of a command. Returns NULL if it isn't an alias */
+char *findAlias(char *name, size_t length);
+
+/* Display all aliases, sorted by name */
+void dispAlias();
+
+/* Save all aliases to a file, returns 0 on success */
+int saveAliases(char *file);
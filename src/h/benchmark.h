@@ -0,0 +1,31 @@
+typedef struct {
+    char name[256]; // File name of the corpus, followed by " (pty)" if it was replayed in a terminal
+    int count; // Number of lines timed
+    double *times[TIMER_COUNT + 1]; // Microseconds spent by each line in each stage (see Timer), then in the whole line
+    double fastest[TIMER_COUNT + 1]; // Median of times in the fastest round, see fastestMedians()
+    double seconds; // Time taken to replay every line
+} Replay;
+
+/* Start the shell in a terminal runs times, reporting how long it took to show the first prompt. Returns the exit status */
+int benchStartup(int runs);
+
+/* Time starting a command with each launch mode, as the shell starts and after it grows. Returns the exit status */
+int benchLaunch(int runs);
+
+/* Time pushing gigabytes of data through pipelines of several commands. Returns the exit status */
+int benchPipe(int gigabytes);
+
+/* Time lexing each line of each corpus given, then fuzz the lexer with mutations of them. Returns the exit status */
+int benchParse(int argc, char const *argv[]);
+
+/* Time lexing generated lines from 100 bytes to 1MB long. Returns the exit status */
+int benchLines(int runs);
+
+/* Replay each corpus of commands given, reporting how long each line takes. Returns the exit status */
+int replayCommands(int argc, char const *argv[]);
+
+/* Sort times into increasing order, ready for percentile() */
+void sortTimes(double *times, int n);
+
+/* The time below which the given fraction (e.g. 0.99) of times fall, times must be sorted */
+double percentile(double *times, int n, double fraction);
@@ -0,0 +1,27 @@
+typedef struct {
+    char *name; // Name the user types to run the builtin
+    int minArgs; // Fewest arguments accepted, not counting the name
+    int maxArgs; // Most arguments accepted, or -1 for no limit
+    char *usage; // How the builtin should be called, shown when the wrong number of arguments are given
+    char *description; // What the builtin does, shown by "builtin -l"
+    int (*run)(int n, char *tokens[]); // Run the builtin, returning its exit status
+    int disabled; // 1 once turned off with "enable -n", so the system command of the same name is run instead
+} Builtin;
+
+/* Find a builtin by name, returns NULL if there is no such builtin or it has been disabled */
+Builtin *findBuiltin(char *name);
+
+/* Find a builtin by name, even if it has been disabled. Returns NULL if there is no such builtin */
+Builtin *lookupBuiltin(char *name);
+
+/* Check the number of arguments then run a builtin, returning its exit status */
+int runBuiltin(Builtin *builtin, int n, char *tokens[]);
+
+/* Check if a builtin runs the rest of the line as a command, e.g. time, returns 1 if so */
+int isPrefixBuiltin(Builtin *builtin);
+
+/* Display every builtin along with how to call it */
+void dispBuiltins();
+
+/* Display every builtin that has been disabled */
+void dispDisabledBuiltins();
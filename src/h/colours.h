@@ -1,6 +1,14 @@
-void colourReset ();
+#define COLOUR_RED "\033[1;31m"
+#define COLOUR_YELLOW "\033[1;33m"
+#define COLOUR_GREEN "\033[1;32m"
+#define COLOUR_BLUE "\033[1;34m"
+#define COLOUR_RESET "\033[0m"
 
-void print(char* message);
+int useColour = 1; // 1 if messages should be coloured, see initialiseOutput()
+
+void initialiseOutput();
+
+void colour(char *code, char *message);
 
 void red(char* message);
 
@@ -8,4 +16,4 @@ void yellow(char* message);
 
 void green(char* message);
 
-void blue(char* message);
\ No newline at end of file
+void blue(char* message);
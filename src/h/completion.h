@@ -0,0 +1,21 @@
+typedef struct {
+    char *name; // Name of the executable
+    uint64_t directories; // Bit i is set if the executable is in the i'th directory indexed from PATH
+} PathCommand;
+
+typedef struct {
+    char *names[COMPLETION_SHOWN]; // The first candidates in order, without duplicates, for listing
+    int shown; // Number of names
+    int count; // Number of candidates, which may be more than are kept in names
+    char *first; // The first candidate found, every candidate begins with its first common bytes
+    size_t common; // Length of the longest prefix shared by every candidate
+} Completions;
+
+/* Start indexing the executables on PATH in the background, for completing commands */
+void startCompletion();
+
+/* Index the executables on PATH again, after it has been changed */
+void completionPathChanged();
+
+/* Complete the word before the cursor when Tab is pressed, listing the candidates if list is 1 */
+void completeWord(Editor *editor, int list);
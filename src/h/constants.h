@@ -1,10 +1,53 @@
-#define PROMPT "$ " /* Prompt shown to the user */
-#define MAX_COMMAND_LENGTH 514 /* Taken from the specification. Maximum length (in terms of characters) of any command. + 2 characters to account for \n and EOF when using fgets [514] */
-#define T_MAX 50 /* Maximum number of tokens that can be stored per command, from the spec [50 when including 0] */
-#define DELIMITERS " \t|><&;\n" /* Tokens as taken from the spec, addition of \n as well */
+#define PROMPT "$ " /* Prompt shown to the user, after any prompt segments */
+#define PROMPT_DEFAULT "cwd git status duration jobs" /* Prompt segments shown unless PROMPT_SEGMENTS is set */
+#define PROMPT_MAX_SEGMENTS 16 /* Maximum number of segments in the prompt */
+#define PROMPT_DURATION_MS 2000 /* Commands taking at least this long have their duration shown in the prompt */
+#define GIT_CACHE_SIZE 16 /* Number of directories whose git status is cached for the prompt */
+#define TOKENS_INITIAL 64 /* Initial size of the tokens array, it grows as needed. Commands are limited only by ARG_MAX */
+#define MAX_STAGES 50 /* Maximum number of commands in a single pipeline */
+#define MAX_JOB_COMMAND 512 /* Maximum length of the command shown for a job, longer commands are cut short */
+#define DELIMITERS " \t\n" /* Tokens as taken from the spec, addition of \n as well. | < > & ; are operators, see pipeline.c */
+#define WORD_END " \t\n;&|<>" /* Characters that end the first word of a command, when looking for an alias */
+#define STATUS_MARK '\x1d' /* Left by the lexer in place of $?, replaced by the exit status of the last command before each command runs */
+#define GLOB_STAR '\x1c' /* Left by the lexer in place of an unquoted *, see glob.c */
+#define GLOB_ONE '\x1e' /* Left by the lexer in place of an unquoted ? */
+#define GLOB_CLASS '\x1f' /* Left by the lexer in place of an unquoted [ */
+#define GLOB_MARKS "\x1c\x1e\x1f" /* Every glob mark, a token holding none of these is never expanded */
+#define GLOB_CACHE_SIZE 64 /* Initial number of slots in the glob directory listing cache, must be a power of 2 */
+#define GLOB_CACHE_BYTES (32 * 1024 * 1024) /* Empty the glob directory listing cache once its listings use this much memory */
+#define GLOB_BUFFER 65536 /* Bytes of directory entries read at a time with getdents64 */
+#define COMPLETION_DIRECTORIES 64 /* Most PATH directories indexed for completion, each has a bit in PathCommand */
+#define COMPLETION_SHOWN 100 /* Most candidates listed when Tab is pressed twice */
+#define COMPLETION_EVENTS 4096 /* Bytes of inotify events read at a time by the PATH index */
 #define MAX_PATH 4096 /* Max size of the CWD */
-#define MAX_HISTORY 21 /* Max number of commands to store in the history */
-#define MAX_ALIAS 20 /* Number of alias' to store (Store 10) */
+#define CLEAR_SCREEN "\33[H\33[2J" /* Move the cursor to the top left of the terminal and clear it */
+#define BENCH_RUNS 50 /* Number of shells started by --bench-startup, unless a number is given */
+#define BENCH_LAUNCH_RUNS 1000 /* Number of commands started with each launch mode by --bench-launch, unless a number is given */
+#define BENCH_LAUNCH_PADDING 256 /* Megabytes the shell grows by for the second half of --bench-launch */
+#define BENCH_PIPE_GIGABYTES 2 /* Gigabytes pushed through each pipeline by --bench-pipe, unless a number is given */
+#define BENCH_PIPE_SIZE (1024 * 1024) /* Pipe capacity compared against the default by --bench-pipe */
+#define BENCH_PARSE_RUNS 1000 /* Number of times --bench-parse lexes each line of a corpus */
+#define BENCH_PARSE_MUTATIONS 2000 /* Number of mutations of each line of a corpus that --bench-parse lexes */
+#define BENCH_PARSE_EDITS 4 /* Most characters replaced, inserted or removed by one mutation */
+#define BENCH_LINES_RUNS 100 /* Number of times --bench-lines lexes each line, unless a number is given */
+#define BENCH_LINES_SHORTEST 100 /* Length in bytes of the shortest line lexed by --bench-lines... */
+#define BENCH_LINES_LONGEST 1000000 /* ...and of the longest, each length is 10 times the one before */
+#define BENCH_TIMEOUT_MS 5000 /* Give up on a shell started by --bench-startup or --replay if it hasn't shown a prompt by now */
+#define REPLAY_ROUNDS 10 /* Number of times --replay runs each corpus, unless --rounds is given */
+#define REPLAY_TOLERANCE 1.5 /* --replay reports a regression when a median is this many times its baseline... */
+#define REPLAY_MIN_US 0.2 /* ...and at least this many microseconds more, so that tiny times don't set it off */
+#define OUTPUT_BUFFER 8192 /* Size of the stdout buffer, output is written when the shell waits for input or starts a command */
+#define HISTORY_SHOWN 20 /* Number of the most recent commands shown by history */
+#define HISTORY_FILE ".hist_list" /* History file, kept in the users' home directory */
+#define HISTORY_SYNC 16 /* Sync the history file to disk after this many commands, unless HISTSYNC is set */
+#define HISTORY_COMPACT_BYTES (8 * 1024 * 1024) /* Compact the history file past this many bytes, when HISTKEEP is set */
+#define TRIGRAM_SIZE 4096 /* Initial number of slots in the history trigram index, must be a power of 2 */
+#define ALIAS_SIZE 64 /* Initial number of slots in the alias hash table, must be a power of 2 */
+#define MAX_REDIRECTS 10 /* Maximum number of redirections for a single command, e.g. "> out.txt 2>&1" is 2 */
+#define MAX_JOBS 32 /* Maximum number of jobs, running or stopped, at any one time */
+#define PARALLEL_OUTPUT 4096 /* Initial size of the buffer collecting the output of each command run by parallel */
+#define HASH_SIZE 64 /* Initial number of slots in the command hash table, must be a power of 2 */
+#define BUILTIN_TABLE_SIZE 256 /* Slots in the builtin perfect hash table, must be a power of 2 and a few times the number of builtins */
 
 char *TOP_BOX =
         "+====================================================================================================+\n";
@@ -27,4 +70,3 @@ char *CREDITS =
 //"=======================\n"
 //"Welcome to Simple Shell\n"
 //"=======================\n";
-
@@ -1,6 +1,3 @@
-/* Display prompt to the user */
-void prompt();
-
 /* Display the users' home directory */
 void displayHome();
 
@@ -10,8 +7,5 @@ void displayPath();
 /* Display the users Current Working Directory */
 void displayCWD();
 
-/* Display the last MAX_HISTORY commands entered by the user */
-void dispHistory(int hIndex, char **history);
-
-/* Display all alias' entered by the user */
-void dispAlias(char **alias, int aIndex);
\ No newline at end of file
+/* Display the last HISTORY_SHOWN commands entered by the user */
+void dispHistory();
@@ -0,0 +1,34 @@
+typedef struct {
+    char *buffer; // Line being edited, NUL terminated
+    size_t length; // Number of bytes in buffer
+    size_t capacity; // Space in buffer before it has to grow
+    size_t cursor; // Byte offset of the cursor in buffer
+
+    char *promptText; // The prompt as it is on screen, redrawn if it changes, see refreshPrompt()
+    int promptWidth; // Columns taken up by the prompt, the line starts after it
+    int columns; // Width of the terminal
+
+    char *shown; // Exactly what is on screen after the prompt, so that only what has changed is redrawn
+    size_t shownLength; // Number of bytes in shown
+    size_t screenCursor; // Column the terminal's cursor is at, counting from the start of the prompt
+
+    char *out; // Everything to be written for this keystroke, sent with a single write
+    size_t outLength; // Number of bytes in out
+    size_t outCapacity; // Space in out before it has to grow
+
+    int recall; // Number of the history command being shown, one past the last command for the line being typed
+    char *saved; // The line being typed, kept while moving through history
+
+    int searching; // 1 during a reverse search (Ctrl-R)
+    char *query; // Text being searched for
+    size_t queryLength; // Number of bytes in query
+    int match; // Number of the command matching the search, or 0 if nothing matches
+
+    int tabs; // Number of times Tab has been pressed in a row, the second lists the candidates, see completion.c
+} Editor;
+
+/* Display the prompt then read a line from the terminal, letting the user edit it. Returns -1 at the end of input */
+ssize_t readLine(char **line, size_t *size);
+
+/* Number of columns text takes up on screen */
+int textColumns(char *text, size_t length);
@@ -1,17 +1,20 @@
 /* Set a new PATH variable */
-void setPath(char *newPath);
+int setPath(char *newPath);
 
 /* Append new directory to the environmental variable PATH*/
-void addPath(char *newPath);
+int addPath(char *newPath);
 
 /* Return the current PATH */
 char *getPath();
 
 /* Set the users home directory and navigate there */
-void setHome(char *dir);
+int setHome(char *dir);
 
 /* Return the users home directory */
 char *getHome();
 
 /* Returns the current working directory */
-char *printCwd();
\ No newline at end of file
+char *getCwd();
+
+/* Change the working directory */
+int changeDirectory(char *dir);
@@ -0,0 +1,45 @@
+typedef struct {
+    uint64_t key; // First 8 bytes of the name, big endian, so that most comparisons while sorting are one instruction
+    char *name; // Name of the entry
+    unsigned char type; // d_type of the entry, e.g. DT_DIR, or DT_UNKNOWN if the file system doesn't say
+} GlobEntry;
+
+typedef struct {
+    dev_t device; // Device and inode of the directory, so a listing is found again whatever path it is reached by
+    ino_t inode;
+    struct timespec modified; // Modification time of the directory when it was read, which changes with its entries
+    time_t read; // When the directory was read
+    int pinned; // Number of globs currently walking this listing, it isn't replaced while they are
+    int temporary; // 1 if this listing isn't in the cache, and is freed once it has been walked
+    char *names; // Every name in the directory apart from . and .., one after another
+    GlobEntry *entries; // The entries, sorted by name
+    int count; // Number of entries
+    size_t bytes; // Memory used by names and entries
+} DirListing;
+
+typedef struct {
+    char path[MAX_PATH]; // The directory being looked in, ending in / unless it is the working directory ("")
+    char *paths; // Every path matched so far, one after another
+    size_t length; // Bytes used in paths
+    size_t size; // Bytes paths can hold before it has to grow
+    size_t *starts; // Where each path matched begins in paths
+    int count; // Number of paths matched
+    int capacity; // Number of starts that can be held before it has to grow
+    long space; // Bytes of arguments left before the command would be too long to run, see argumentSpace()
+    int overflow; // 1 once the paths matched have run out of space
+} GlobWalk;
+
+typedef struct {
+    char **tokens; // The tokens after expansion, NULL terminated. The tokens given, if there was nothing to expand
+    char *paths; // The paths that globs matched, one after another, which tokens point into
+} Glob;
+
+/* Match a pattern against the file system, adding each path it matches to the walk */
+void globWalk(GlobWalk *walk, size_t length, char *pattern);
+
+/* Expand any globs in the tokens of a command, e.g. *.c, into the paths they match. Returns the number of tokens
+ * after expansion, or -1 if they would be too long to run. freeGlob() must be called once the tokens are finished with */
+int expandGlobs(char *tokens[], int n, Glob *glob);
+
+/* Free the memory used by the tokens from expandGlobs() */
+void freeGlob(Glob *glob);
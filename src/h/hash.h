@@ -0,0 +1,11 @@
+/* Return the absolute path of an executable, checking the command hash table before searching PATH */
+char *hashLookup(char *command);
+
+/* Remove a single command from the command hash table */
+void hashForget(char *command);
+
+/* Remove every command from the command hash table, e.g. when PATH is replaced */
+void hashReset();
+
+/* Display every hashed command along with the number of hits and misses */
+void dispHash();
\ No newline at end of file
@@ -0,0 +1,30 @@
+typedef struct {
+    unsigned int trigram; // Three characters packed into an int, plus 1 so that 0 can mark a free slot
+    int *numbers; // Numbers of the commands containing this trigram, in increasing order
+    int count; // Number of commands in numbers
+    int capacity; // Space in numbers before it has to grow
+} Posting;
+
+/* Open the history file and start loading every command from it in the background. Otherwise done on first use */
+void loadHistory();
+
+/* Add a command to history and append it to the history file */
+void addHistory(char *command);
+
+/* Get command number n from history, starting from 1. Returns NULL if there is no such command */
+char *getHistory(int number);
+
+/* The number of commands in history */
+int historyLength();
+
+/* Number of the most recent command below before, starting with (prefix = 1) or containing the pattern, or 0 if none */
+int findHistory(char *pattern, int prefix, int before);
+
+/* Display every command containing the pattern, returning the number found */
+int searchHistory(char *pattern);
+
+/* Remove every command from history and from the history file */
+void clearHistory();
+
+/* Make sure every command appended has reached the disk, then close the history file */
+void closeHistory();
@@ -0,0 +1,61 @@
+typedef struct {
+    int id; // Job number shown to the user, 0 if this slot is free
+    pid_t pgid; // Process group of every process in the job
+    pid_t pids[MAX_STAGES]; // Each process in the job, in pipeline order
+    int statuses[MAX_STAGES]; // Last status reported for each process
+    int nProcs; // Number of processes in the job
+    int remaining; // Number of processes that have not finished
+    int stopped; // Number of processes currently stopped
+    int stopSignal; // Signal that last stopped a process in the job
+    int foreground; // 1 while the shell is waiting for this job
+    struct rusage usage; // Resources used by the processes in the job that have finished, added together
+    char command[MAX_JOB_COMMAND]; // Command line shown to the user
+} Job;
+
+struct rusage lastJobUsage; // Resources used by the last job waited for in the foreground, see waitForJob()
+int jobsWaited = 0; // Number of jobs waited for in the foreground, so it is possible to tell if lastJobUsage is new
+
+/* Install the SIGCHLD handler which reaps children as they finish */
+void initialiseJobs();
+
+/* Create a new job for a pipeline that is about to be launched. SIGCHLD must be blocked */
+Job *newJob(Pipeline *pipeline, int background);
+
+/* Add a launched process to a job. SIGCHLD must be blocked */
+void addToJob(Job *job, pid_t pid);
+
+/* Wait for a job in the foreground, returning its exit status. SIGCHLD must be blocked */
+int waitForJob(Job *job);
+
+/* Add the resources in usage to total. The maximum resident set size is the larger of the two */
+void addUsage(struct rusage *total, struct rusage *usage);
+
+/* Catch Ctrl+C in an interactive shell, so that it ends builtins such as wait rather than the shell */
+void catchInterrupts();
+
+/* Block or unblock SIGCHLD, so that the job table can be read or updated safely */
+void blockChildSignal(int block);
+
+/* Start a thread with every signal blocked, returns 0 on success */
+int startThread(pthread_t *thread, void *(*run)(void *));
+
+/* Tell the user about background jobs that have finished since the last prompt */
+void notifyJobs();
+
+/* Display all jobs */
+void dispJobs();
+
+/* Continue a job in the foreground, returning its exit status */
+int foregroundJob(char *spec);
+
+/* Continue a stopped job in the background */
+int backgroundJob(char *spec);
+
+/* Wait for a background job, or all of them, to finish */
+int waitJobs(char *spec);
+
+/* Number of jobs, running or stopped */
+int countJobs();
+
+/* Hang up any jobs still left when the shell exits */
+void hangupJobs();
\ No newline at end of file
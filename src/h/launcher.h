@@ -0,0 +1,26 @@
+typedef struct {
+    int in; // File descriptor to use as stdin, or -1 to use the shell's
+    int out; // File descriptor to use as stdout, or -1 to use the shell's
+    int err; // File descriptor to use as stderr, or -1 to use the shell's
+    pid_t pgid; // Process group to join, or 0 to start a new group led by this process
+    Redirect *redirects; // Redirections to apply after connecting stdin and stdout
+    int nRedirects; // Number of redirections
+    int foreground; // 1 if the process should be given the terminal
+} LaunchIO;
+
+/* Open the files for each redirection and put them in place, returns the index of the one that failed, or -1 */
+int applyRedirects(Redirect *redirects, int n);
+
+/* Start a new process running the executable at path, using the current launch mode. Returns the pid, -2 if a
+ * redirection couldn't be opened, or -1 if the process couldn't be started */
+pid_t launchProcess(char *path, char **argv, LaunchIO *io);
+
+/* Start a builtin in a child process, as one stage of a pipeline. Returns the pid, -2 if a redirection couldn't be
+ * opened, or -1 if the child couldn't be started */
+pid_t launchBuiltin(Builtin *builtin, char **argv, LaunchIO *io);
+
+/* Set the method used to launch new processes, returns 0 if the mode name is valid */
+int setLaunchMode(char *mode);
+
+/* Display the method currently used to launch new processes */
+void displayLaunchMode();
\ No newline at end of file
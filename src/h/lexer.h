@@ -0,0 +1,19 @@
+typedef struct {
+    const char *special; // The characters to look for
+#if defined(__AVX2__)
+    __m256i wanted[16]; // Each character repeated across a register
+#elif defined(__SSE2__)
+    __m128i wanted[16]; // Each character repeated across a register
+#endif
+    int nWanted; // Number of characters in special, at most 16
+} Needles;
+
+/* Build the sets of characters that end a run of plain characters. Must be called before anything is lexed */
+void initialiseLexer();
+
+/* Split a line into tokens in place, handling quotes, backslashes and operators. The tokens array grows as needed.
+ * Returns the number of tokens, or -1 if a quote was left unterminated */
+int lexLine(char *line, char ***tokens, int *capacity);
+
+/* Replace each $? in the tokens with the exit status given. Returns memory to free once the tokens are finished with */
+char *expandStatus(char *tokens[], int n, int status);
@@ -1,45 +1,37 @@
 char* originalPATH; // PATH variable before the Simple Shell starts up
 char* originalHOME; // Home directory before the Simple Shell starts up
-int numCommands = 0; // Number of commands executed since Simple Shell start up
+int lastStatus = 0; // Exit status of the last command that was run
+long lastDuration = 0; // How long the last command took to run, in milliseconds
+int interactive = 1; // 1 if commands are being typed in by the user, 0 if running a script, see readArguments()
+int keepHistory = 1; // 1 if commands are added to the history file, scripts don't keep history
+int stopOnError = 0; // 1 if the shell should exit as soon as a command fails
+int verbose = 0; // 1 to show the banner and information about the shell when it starts and exits, see -v
+int useZygote = 0; // 1 to launch commands through the zygote, see -z
+int shellTerminal = -1; // File descriptor of the terminal the shell controls, or -1 if it isn't running in one
 
-/* Clear the input buffer */
-void clearBuffer(char command[]);
+/* Decide where to read commands from, based on the arguments the shell was started with */
+FILE *readArguments(int argc, char const *argv[]);
+
+/* Run a line of input, recalling it from history or adding it to history first */
+void runLine(char **commandBuffer, size_t *commandSize);
 
 /* Parse user input, returning number of tokens generated */
-int parseInput(char command[], int tIndex, char *tokens[], char *override, int aIndex, char **history, int hIndex);
+int parseInput(char command[], char ***tokens, int *tCapacity);
+
+/* Handle each of the tokens (Commands) entered by the user, returning the exit status */
+int processCommand(int n, char *tokens[]);
 
-/* Handle each of the tokens (Commands) entered by the user */
-void processCommand(int n, char *tokens[], char **history, int *hIndex, char **alias, int *aIndex, int tIndex);
+/* Run a command as a builtin or system commands, or only as system commands if external is 1. Returns the exit status */
+int runCommand(int n, char *tokens[], int external);
 
 /* Handles startup processes for the shell */
-void startShell(char** history, int* hIndex, char** alias, int* aIndex);
+void startShell();
 
 /* Change the working directory */
-void cd(char *filepath);
+int cd(char *filepath);
 
 /* Close the Simple Shell, restore path and save command history */
-void closeShell(char **history, int hIndex, char **alias, int aIndex);
-
-/* Increment index of next command in history */
-int incrementHIndex(int hIndex);
-
-/* Initialise the history array */
-int initialiseHistory(char **history);
-
-/* Clear the history array */
-int clearHistory(char **history);
+void closeShell();
 
 /* Return if the command was a history call */
-int isHistory(char *command, int hIndex);
-
-/* adds the users input alias into the alias array*/
-int addAlias(char **alias, int aIndex, char *name, char *command, char *tokens[], int tIndex, char **history, int *hIndex);
-
-/* Initialise the alias array */
-int initialiseAlias(char** alias);
-
-/* Remove an alias */
-int unAlias(char **alias, int aIndex, char *command);
-
-/* Check if a command is an alias */
-int isAlias(char *command, char **alias, int aIndex);
\ No newline at end of file
+int isHistory(char *command);
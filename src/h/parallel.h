@@ -0,0 +1,15 @@
+typedef struct {
+    int fd; // Read end of the pipe collecting what the command writes, -1 once it has all been read
+    char *buffer; // Collected so far, printed in one go when the command finishes so it isn't mixed with others
+    size_t length; // Number of bytes in buffer
+    size_t capacity; // Space in buffer before it has to grow
+} Capture;
+
+typedef struct {
+    Job *job; // Job running this worker's command, NULL while the worker is free
+    Capture output; // The command's stdout
+    Capture errors; // The command's stderr
+} Worker;
+
+/* Run a command once for each batch of arguments, several at a time, returning 0 if every command succeeded */
+int runParallel(int n, char *tokens[]);
@@ -0,0 +1,63 @@
+typedef enum {
+    OP_NONE,
+    OP_PIPE, // |
+    OP_IN, // <
+    OP_OUT, // >
+    OP_APPEND, // >>
+    OP_ERR_OUT, // 2>
+    OP_ERR_APPEND, // 2>>
+    OP_ERR_TO_OUT, // 2>&1
+    OP_BACKGROUND, // &
+    OP_AND, // &&
+    OP_OR, // ||
+    OP_SEMICOLON // ;
+} Operator;
+
+typedef struct {
+    Operator type; // Which redirection this is, e.g. OP_OUT for >
+    char *target; // File to redirect to or from, NULL for 2>&1
+} Redirect;
+
+typedef struct {
+    char **argv; // NULL terminated arguments of this command, pointing into the tokens array
+    int argc; // Number of arguments, including the command itself
+    Redirect redirects[MAX_REDIRECTS]; // Redirections for this command, applied in the order they were entered
+    int nRedirects; // Number of redirections
+} Stage;
+
+typedef struct {
+    Stage stages[MAX_STAGES]; // Each command in the pipeline, in the order that data flows through them
+    int nStages; // Number of commands in the pipeline
+    int background; // 1 if the pipeline should be run in the background, i.e. it ended with &
+} Pipeline;
+
+/* Return the longest operator beginning at position, or OP_NONE. Digit-led operators such as 2> only match at the start of a word */
+Operator matchOperator(char *position, int wordStart, int *length);
+
+/* Return the operator that a token represents, or OP_NONE if it is a regular word */
+Operator operatorType(char *token);
+
+/* Check that the tokens make a valid pipeline without changing them, returns 0 if they do */
+int checkPipeline(char *tokens[], int n);
+
+/* Split the tokens into the stages of a pipeline and collect any redirections, returns 0 on success */
+int buildPipeline(char *tokens[], int n, Pipeline *pipeline);
+
+/* Apply redirections to the shell itself, so that a builtin can use them. Returns 0 on success */
+int redirectShell(Stage *stage, int saved[3]);
+
+/* Undo redirections applied by redirectShell() */
+void restoreShell(int saved[3]);
+
+/* Run a list of commands joined by ;, &, && or ||, returning the exit status of the last command run */
+int runList(char *tokens[], int n);
+
+/* Run every stage of a pipeline and wait for them all to finish, returning the exit status of the last stage.
+ * Background pipelines are not waited for. external is 1 if the first stage must be a system command */
+int runPipeline(Pipeline *pipeline, int external);
+
+/* Set the capacity of pipes created between stages, returns 0 on success */
+int setPipeSize(char *size);
+
+/* Display the capacity of pipes created between stages */
+void displayPipeSize();
\ No newline at end of file
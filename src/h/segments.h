@@ -0,0 +1,35 @@
+typedef struct {
+    char *text; // The prompt so far, including colours
+    size_t length; // Number of bytes in text
+    size_t capacity; // Space in text before it has to grow
+    int columns; // Number of columns the prompt takes up on screen, not counting colours
+} PromptText;
+
+typedef struct {
+    char *name; // Name used in PROMPT_SEGMENTS
+    void (*render)(PromptText *prompt); // Add the segment to the prompt, adding nothing if it has nothing to show
+} Segment;
+
+typedef struct {
+    char *directory; // Directory the status is for, NULL if this slot is free
+    char *branch; // Branch checked out, NULL if the directory isn't in a git repository or isn't known yet
+    int dirty; // 1 if tracked files have been changed
+    int generation; // Value of promptGeneration when the status was worked out, see segmentsStale()
+    int pending; // 1 while the status is being worked out again
+    unsigned long used; // When this slot was last used, the least recently used slot is replaced
+} GitStatus;
+
+/* Build the prompt from its segments, setting columns to its width. The prompt is valid until the next call */
+char *buildPrompt(int *columns);
+
+/* Build the prompt again next time, e.g. after changing directory */
+void promptChanged();
+
+/* Mark anything worked out in the background as out of date, e.g. after a command has run */
+void segmentsStale();
+
+/* File descriptor which becomes readable when a segment has fresh data, or -1 if there is nothing to wait for */
+int segmentsFd();
+
+/* Read everything waiting on segmentsFd() */
+void segmentsDrain();
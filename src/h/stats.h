@@ -0,0 +1,47 @@
+typedef enum {
+    TIMER_INPUT, // Waiting for a line to be typed in, or read from a script
+    TIMER_COMPLETE, // Completing a word when Tab is pressed, part of input
+    TIMER_HISTORY, // Recalling a command from history, or adding it to history
+    TIMER_ALIAS, // Expanding an alias
+    TIMER_PARSE, // Splitting the command into tokens
+    TIMER_GLOB, // Expanding globs, e.g. *.c
+    TIMER_BUILTIN, // Running a builtin
+    TIMER_LAUNCH, // Starting a process, e.g. fork and exec
+    TIMER_WAIT, // Waiting for a command in the foreground to finish
+    TIMER_COUNT
+} Timer;
+
+typedef struct {
+    long long count; // Number of times timed
+    long long nanoseconds; // Total time
+    long long longest; // Longest single time, in nanoseconds
+} TimerStats;
+
+/* Nanoseconds on the monotonic clock, for timing */
+long long nanoseconds();
+
+/* Add the time since started, a time from nanoseconds(), to a timer */
+void stopTimer(Timer timer, long long started);
+
+/* Display every timer and allocation count */
+void dispStats();
+
+/* Set every timer and allocation count back to 0 */
+void resetStats();
+
+/* Allocate memory, counting the allocation, see stats.c */
+void *countedMalloc(size_t size);
+void *countedCalloc(size_t n, size_t size);
+void *countedRealloc(void *memory, size_t size);
+char *countedStrdup(const char *text);
+char *countedStrndup(const char *text, size_t length);
+void countedFree(void *memory);
+
+// Every allocation made by the shell is counted. System headers are included before this, so only the shell's own
+// calls are replaced
+#define malloc(size) countedMalloc(size)
+#define calloc(n, size) countedCalloc(n, size)
+#define realloc(memory, size) countedRealloc(memory, size)
+#define strdup(text) countedStrdup(text)
+#define strndup(text, length) countedStrndup(text, length)
+#define free(memory) countedFree(memory)
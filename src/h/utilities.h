@@ -0,0 +1,11 @@
+/* Display an error from a utility on stderr, after "[Error] " */
+void utilityError(char *format, ...);
+
+/* Expand the backslash escapes in text into out, returning the number of bytes written. stop is set by \\c */
+size_t expandEscapes(char *text, char *out, int octalZero, int *stop);
+
+/* Evaluate the arguments of test, returning 0 if the expression is true, 1 if false, or 2 on error */
+int testExpression(char *args[], int n);
+
+/* Find a signal from its name or number, e.g. "TERM" or "15". Returns -1 if there is no such signal */
+int signalNumber(char *name);
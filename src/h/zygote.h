@@ -0,0 +1,18 @@
+typedef struct {
+    size_t length; // Bytes of strings following the request: the path, working directory, arguments, then environment
+    int argc; // Number of arguments
+    int envc; // Number of environment variables
+    pid_t pgid; // Process group to join, or 0 to start a new group led by the new process
+    int foreground; // 1 if the new process should be given the terminal, which is sent as a fourth file descriptor
+} ZygoteRequest;
+
+typedef struct {
+    pid_t pid; // The new process, or -1 if it couldn't be started
+    int error; // errno from starting the process, 0 on success
+} ZygoteReply;
+
+/* Fork the zygote, which launches commands on the shell's behalf. Returns 0 on success */
+int startZygote();
+
+/* Launch a command through the zygote. Returns the pid, or -1 with error set to errno if it couldn't be started */
+pid_t zygoteLaunch(char *path, char **argv, LaunchIO *io, int fds[3], int *error);
@@ -0,0 +1,75 @@
+#!/bin/sh
+# Run scripts through the shell and check their output and exit status, e.g. "tests/script-mode.sh ./SimpleShell"
+# Each case gives a script, the output it should print, and the status the shell should exit with
+
+shell=${1:-./SimpleShell}
+failed=0
+
+# check <name> <options> <script> <expected output> <expected status>
+check() {
+    output=$(printf '%s\n' "$3" | "$shell" $2 2>&1)
+    status=$?
+
+    if [ "$output" != "$4" ] || [ "$status" != "$5" ]; then
+        printf 'FAIL %s\n  expected status %s, output:\n%s\n  got status %s, output:\n%s\n' "$1" "$5" "$4" "$status" \
+            "$output"
+        failed=1
+    else
+        printf 'ok   %s\n' "$1"
+    fi
+}
+
+check "-e stops at a failure" -e 'echo a
+false
+echo b' 'a' 1
+
+check "-e allows a failure followed by &&" -e 'false && echo y
+echo z' 'z' 0
+
+check "-e stops at a failure after the last ||" -e 'false || false
+echo z' '' 1
+
+check "-e allows a failure followed by || which recovers" -e 'false || echo y
+echo z' 'y
+z' 0
+
+check "A redirection without a file stops the whole line" "" 'echo a; echo b >; echo c' \
+    '[Error] ">" must be followed by a file name' 2
+
+check "An empty stage stops the whole line" "" 'echo first; ls | ; echo x' \
+    '[Error] Each side of a "|" must have a command. Try calling "<command> | <command>"' 2
+
+check "A misplaced & stops the whole line" "" 'echo a; & echo b' \
+    '[Error] "&" must come between two commands. Try calling "<command> & <command>"' 2
+
+check "A builtin can be a stage of a pipeline" "" 'alias ll ls > /dev/null
+alias | grep ll | tr l L
+echo b a | tr " " "\n" | sort' ' "LL"	"Ls"
+a
+b' 0
+
+check "A builtin in a pipeline runs in a child" "" 'cd / | cat
+exit 3 | cat
+pwd | grep -cx /' '0' 1
+
+check "exit rejects a status that isn't a number" "" 'exit abc
+echo $?' '[Error] "abc" is not a valid exit status. Try calling "exit [status]"
+2' 0
+
+check "exit uses the status given" "" 'exit 3
+echo unreachable' '' 3
+
+globs=$(mktemp -d)
+mkdir -p "$globs/a/b" && touch "$globs/x1" "$globs/9y"
+check "Named classes and ** in globs" "" "cd $globs
+echo [[:alpha:]]* [![:alpha:]]*
+echo **/b/**" 'a x1 9y
+a/b' 0
+rm -rf "$globs"
+
+for mode in fork vfork spawn zygote; do
+    check "A missing redirection target with $mode" "" "launcher $mode > /dev/null
+cat < /nonexistent" '[Error] /nonexistent: No such file or directory' 1
+done
+
+exit $failed